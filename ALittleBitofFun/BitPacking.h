@@ -0,0 +1,126 @@
+#ifndef BITPACKING_H
+#define BITPACKING_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include "BitWriter.h"
+#include "BitReader.h"
+#include "UniversalCodes.h"
+
+// frame-of-reference bit packing for blocks of 128 uint32 values
+//
+// Block layout (starts on a byte boundary):
+//
+//   reference   32 bits   the smallest value in the block
+//   width        8 bits   bits per packed value, 0 to 32
+//   values      128 * width bits: each value minus the reference, MSB-first
+//
+// A block is 5 + 16 * width bytes, so consecutive blocks stay byte-aligned and the decoder
+// can copy each payload out whole and unpack it with a kernel specialised for its width.
+//
+// Array layout: the value count in LEB128, then ceil(count / 128) blocks; the last block is
+// padded with copies of its reference value.
+
+const size_t kPackBlockSize = 128;
+
+// packs exactly kPackBlockSize values
+inline void packBlock(BitWriter& writer, const uint32_t* values) {
+    auto [low, high] = std::minmax_element(values, values + kPackBlockSize);
+    uint32_t reference = *low;
+    unsigned width = (unsigned)std::bit_width(*high - reference);
+
+    writer.alignToByte();
+    writer.writeBits(reference, 32);
+    writer.writeBits(width, 8);
+    if (width == 0) return;
+
+    // Two values per call, so writeBits does half the accumulator work
+    for (size_t i = 0; i < kPackBlockSize; i += 2) {
+        writer.writeBits(((uint64_t)(values[i] - reference) << width) | (values[i + 1] - reference), 2 * width);
+    }
+}
+
+// unpacks 128 values of a fixed width from an MSB-first payload with at least 8 readable
+// bytes past its end; the trip count and every shift are compile-time constants, so the
+// loop fully unrolls into straight-line loads and shifts
+template <unsigned Width>
+void unpackKernel(const uint8_t* payload, uint32_t reference, uint32_t* out) {
+    for (size_t i = 0; i < kPackBlockSize; i++) {
+        if constexpr (Width == 0) {
+            out[i] = reference;
+        } else {
+            size_t bit = i * Width;
+            const uint8_t* p = payload + bit / 8;
+            uint64_t word = 0;
+            for (int j = 0; j < 8; j++) {
+                word = (word << 8) | p[j];
+            }
+            out[i] = reference + (uint32_t)((word << (bit % 8)) >> (64 - Width));
+        }
+    }
+}
+
+using UnpackKernel = void (*)(const uint8_t*, uint32_t, uint32_t*);
+
+template <size_t... Widths>
+constexpr std::array<UnpackKernel, sizeof...(Widths)> makeUnpackKernels(std::index_sequence<Widths...>) {
+    return {&unpackKernel<Widths>...};
+}
+
+// one kernel per width, 0 to 32
+inline constexpr std::array<UnpackKernel, 33> kUnpackKernels = makeUnpackKernels(std::make_index_sequence<33>());
+
+// unpacks one block written by packBlock into out[0..127]
+// throws std::out_of_range on a truncated stream or a width over 32
+inline void unpackBlock(BitReader& reader, uint32_t* out) {
+    reader.alignToByte();
+    uint32_t reference = (uint32_t)reader.readBits(32);
+    unsigned width = (unsigned)reader.readBits(8);
+    if (width > 32) throw std::out_of_range("bit-packed block wider than 32 bits");
+
+    std::array<uint8_t, kPackBlockSize * 4 + 8> payload{};
+    reader.readBytes(payload.data(), kPackBlockSize / 8 * width);
+    kUnpackKernels[width](payload.data(), reference, out);
+}
+
+inline void packArray(BitWriter& writer, const uint32_t* values, size_t count) {
+    writeLeb128(writer, count);
+    size_t full = count / kPackBlockSize * kPackBlockSize;
+    for (size_t i = 0; i < full; i += kPackBlockSize) {
+        packBlock(writer, values + i);
+    }
+    if (full < count) {
+        std::array<uint32_t, kPackBlockSize> last;
+        uint32_t reference = *std::min_element(values + full, values + count);
+        std::fill(std::copy(values + full, values + count, last.begin()), last.end(), reference);
+        packBlock(writer, last.data());
+    }
+}
+
+inline void packArray(BitWriter& writer, const std::vector<uint32_t>& values) {
+    packArray(writer, values.data(), values.size());
+}
+
+// reads an array written by packArray into out
+// throws std::out_of_range on a truncated stream, leaving out partly filled
+inline void unpackArray(BitReader& reader, std::vector<uint32_t>& out) {
+    uint64_t count = readLeb128(reader);
+    // Every block takes at least 5 bytes, which bounds what a corrupt count can allocate;
+    // compared before rounding up, since rounding a count near 2^64 would wrap to 0 blocks
+    if (count > reader.remaining() / 40 * kPackBlockSize) {
+        throw std::out_of_range("bit-packed array longer than its stream");
+    }
+    uint64_t blocks = (count + kPackBlockSize - 1) / kPackBlockSize;
+
+    out.resize(blocks * kPackBlockSize);
+    for (uint64_t b = 0; b < blocks; b++) {
+        unpackBlock(reader, out.data() + b * kPackBlockSize);
+    }
+    out.resize(count);
+}
+
+#endif //BITPACKING_H
@@ -0,0 +1,157 @@
+#ifndef BITREADER_H
+#define BITREADER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "BitWriter.h"
+
+// reads bits back in the layout BitWriter produces: MSB-first, the last byte zero-padded
+class BitReader {
+
+public:
+    // reads bitCount bits from data, which must hold at least (bitCount + 7) / 8 bytes
+    // and outlive the reader
+    BitReader(const uint8_t* data, size_t bitCount)
+        : data(data), numBytes((bitCount + 7) / 8), bitCount(bitCount), next(0), cache(0), cacheBits(0),
+          bitPosition(0) {}
+
+    BitReader(const std::vector<uint8_t>& bytes, size_t bitCount)
+        : BitReader(bytes.data(), std::min(bitCount, bytes.size() * 8)) {}
+
+    explicit BitReader(const BitView& view) : BitReader(view.bytes.data(), view.bitCount) {}
+
+    // reads one bit; throws std::out_of_range past the end
+    bool readBit() {
+        if (bitPosition >= bitCount) throw std::out_of_range("BitReader: read past the end");
+        if (cacheBits == 0) refill();
+
+        bool bit = (cache >> 63) != 0;
+        cache <<= 1;
+        cacheBits--;
+        bitPosition++;
+        return bit;
+    }
+
+    // reads n bits (0 <= n <= 64), the first one read becoming the most significant,
+    // so it returns what writeBits(value, n) wrote; throws std::out_of_range past the end
+    uint64_t readBits(unsigned n) {
+        if (n > 56) {
+            uint64_t high = readBits(n - 32);
+            return (high << 32) | readBits(32);
+        }
+        uint64_t value = peekBits(n);
+        consume(n);
+        return value;
+    }
+
+    // the next n bits (0 <= n <= 56) without consuming them; throws std::out_of_range past the end
+    uint64_t peekBits(unsigned n) {
+        if (n > 56) throw std::invalid_argument("BitReader: can peek at most 56 bits");
+        if (n > remaining()) throw std::out_of_range("BitReader: read past the end");
+        if (n == 0) return 0;
+        if (n > cacheBits) refill();
+        return cache >> (64 - n);
+    }
+
+    // skips n bits; throws std::out_of_range past the end
+    void skipBits(size_t n) {
+        if (n > remaining()) throw std::out_of_range("BitReader: skip past the end");
+        while (n > 0) {
+            unsigned step = n < 56 ? (unsigned)n : 56;
+            if (step > cacheBits) refill();
+            consume(step);
+            n -= step;
+        }
+    }
+
+    // reads whole bytes; straight from the input when the reader is byte-aligned
+    // throws std::out_of_range past the end
+    void readBytes(uint8_t* out, size_t size) {
+        if (size > remaining() / 8) throw std::out_of_range("BitReader: read past the end");
+        if (!isAligned()) {
+            for (size_t i = 0; i < size; i++) out[i] = (uint8_t)readBits(8);
+            return;
+        }
+
+        // Aligned, so the cache holds whole bytes; drain those, then copy the rest
+        size_t i = 0;
+        for (; i < size && cacheBits >= 8; i++) out[i] = (uint8_t)readBits(8);
+        size_t start = bitPosition / 8;
+        std::memcpy(out + i, data + start, size - i);
+        next = start + (size - i);
+        cache = 0;
+        cacheBits = 0;
+        bitPosition += (size - i) * 8;
+    }
+
+    // skips the padding up to the next byte boundary (or to the end, if that comes first)
+    void alignToByte() {
+        skipBits(std::min(bitsToAlignment(), remaining()));
+    }
+
+    bool isAligned() const {
+        return bitPosition % 8 == 0;
+    }
+
+    size_t bitsToAlignment() const {
+        return (8 - bitPosition % 8) % 8;
+    }
+
+    // number of bits read so far
+    size_t position() const {
+        return bitPosition;
+    }
+
+    size_t remaining() const {
+        return bitCount - bitPosition;
+    }
+
+    size_t size() const {
+        return bitCount;
+    }
+
+    bool atEnd() const {
+        return bitPosition >= bitCount;
+    }
+
+private:
+    const uint8_t* data;
+    size_t numBytes;
+    size_t bitCount;
+    size_t next;        // next byte to load into the cache
+    uint64_t cache;     // upcoming bits, MSB-first
+    unsigned cacheBits; // valid bits at the top of cache
+    size_t bitPosition;
+
+    // tops the cache up to at least 56 bits (or everything left)
+    void refill() {
+        if (next + 8 <= numBytes) {
+            // One unaligned load; any bits of a partly loaded byte are loaded again next time
+            uint64_t word = 0;
+            for (int i = 0; i < 8; i++) {
+                word = (word << 8) | data[next + i];
+            }
+            cache |= word >> cacheBits;
+            next += (63 - cacheBits) >> 3;
+            cacheBits |= 56;
+            return;
+        }
+
+        // Near the end, a byte at a time
+        while (cacheBits <= 56 && next < numBytes) {
+            cache |= (uint64_t)data[next++] << (56 - cacheBits);
+            cacheBits += 8;
+        }
+    }
+
+    void consume(unsigned n) {
+        cache <<= n;
+        cacheBits -= n;
+        bitPosition += n;
+    }
+};
+
+#endif //BITREADER_H
@@ -4,63 +4,417 @@
 #include <vector>
 #include <cstdint>
 #include <string>
-#include <sstream>
-#include <iomanip>
+#include <array>
+#include <cstring>
+#include <span>
+#include <functional>
+#include <ostream>
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
-class BitWriter {
+// a read-only look at the bytes a BitWriter is holding; valid until the next write
+struct BitView {
+    std::span<const uint8_t> bytes; // in the writer's bit order, the last byte zero-padded
+    size_t bitCount;                // number of bits in bytes
+};
+
+// Bit order policies. Each says how bits collect in the writer's 64-bit accumulator and how
+// a full accumulator is laid out in memory; the writer is instantiated per policy, so the hot
+// loops compile to straight-line shifts with no per-bit check of the order.
+//
+// MsbFirst: the first bit written is the most significant bit of its byte, and writeBits sends
+// the most significant bit of a value first, so multi-byte fields come out big-endian (network
+// order). The accumulator holds pending bits right-aligned, oldest on top.
+struct MsbFirst {
+    // appends n bits to an accumulator holding bits pending bits (bits + n < 64)
+    static uint64_t append(uint64_t accumulator, unsigned, uint64_t value, unsigned n) {
+        return (accumulator << n) | value;
+    }
+
+    // the full word made of the pending bits and the first 64 - bits of value's n bits
+    static uint64_t fill(uint64_t accumulator, unsigned bits, uint64_t value, unsigned n) {
+        return (bits == 0 ? 0 : accumulator << (64 - bits)) | (value >> (n - (64 - bits)));
+    }
+
+    // the rest of value's n bits once the first 64 - bits have gone into a full word
+    static uint64_t leftover(uint64_t value, unsigned bits, unsigned n) {
+        unsigned rest = n - (64 - bits);
+        return rest == 0 ? 0 : value & (((uint64_t)1 << rest) - 1);
+    }
+
+    // removes the oldest whole byte from an accumulator holding bits pending bits (bits >= 8)
+    static uint8_t takeByte(uint64_t& accumulator, unsigned bits) {
+        return (uint8_t)(accumulator >> (bits - 8));
+    }
+
+    // the pending bits (bits < 8) as a zero-padded byte
+    static uint8_t partialByte(uint64_t accumulator, unsigned bits) {
+        return (uint8_t)(accumulator << (8 - bits));
+    }
+
+    static void storeWord(uint8_t* out, uint64_t word) {
+        for (int i = 7; i >= 0; i--) {
+            out[i] = (uint8_t)word;
+            word >>= 8;
+        }
+    }
+
+    // the word that writes these 8 bytes in order
+    static uint64_t loadWord(const uint8_t* in) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; i++) {
+            word = (word << 8) | in[i];
+        }
+        return word;
+    }
+};
+
+// LsbFirst: the first bit written is the least significant bit of its byte, and writeBits sends
+// the least significant bit of a value first, as DEFLATE does, so multi-byte fields come out
+// little-endian. The accumulator holds pending bits right-aligned, oldest at the bottom.
+struct LsbFirst {
+    static uint64_t append(uint64_t accumulator, unsigned bits, uint64_t value, unsigned) {
+        return accumulator | (value << bits);
+    }
+
+    static uint64_t fill(uint64_t accumulator, unsigned bits, uint64_t value, unsigned) {
+        return accumulator | (value << bits);
+    }
+
+    static uint64_t leftover(uint64_t value, unsigned bits, unsigned n) {
+        return n == 64 - bits ? 0 : value >> (64 - bits);
+    }
+
+    static uint8_t takeByte(uint64_t& accumulator, unsigned) {
+        uint8_t byte = (uint8_t)accumulator;
+        accumulator >>= 8;
+        return byte;
+    }
+
+    static uint8_t partialByte(uint64_t accumulator, unsigned) {
+        return (uint8_t)accumulator;
+    }
+
+    static void storeWord(uint8_t* out, uint64_t word) {
+        for (int i = 0; i < 8; i++) {
+            out[i] = (uint8_t)word;
+            word >>= 8;
+        }
+    }
+
+    static uint64_t loadWord(const uint8_t* in) {
+        uint64_t word = 0;
+        for (int i = 7; i >= 0; i--) {
+            word = (word << 8) | in[i];
+        }
+        return word;
+    }
+};
+
+template <typename BitOrder>
+class BasicBitWriter {
 
 public:
-    BitWriter() : currentByte(0), bitCount(0), currentBitPosition(7) {}
+    // receives each chunk of finished bytes; the data is only valid during the call
+    using Sink = std::function<void(const uint8_t* data, size_t size)>;
+
+    BasicBitWriter() : accumulator(0), accumulatorBits(0), bitCount(0), flushedBytes(0), tailInBuffer(false),
+                       chunkSize(0) {}
+
+    // a sink that writes each chunk to out
+    static Sink ostreamSink(std::ostream& out) {
+        return [&out](const uint8_t* data, size_t size) {
+            out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        };
+    }
+
+    // a sink that writes each chunk to a POSIX file descriptor; throws std::system_error on failure
+    static Sink fdSink(int fd) {
+        return [fd](const uint8_t* data, size_t size) {
+            while (size > 0) {
+                ssize_t written = ::write(fd, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::system_error(errno, std::generic_category(), "BitWriter fd sink");
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+        };
+    }
+
+    // hands finished bytes to sink in chunks of chunkSize bytes as they fill, so the writer
+    // never holds much more than one chunk; bytes already in the writer go with the first chunk
+    void setSink(Sink newSink, size_t newChunkSize = 64 * 1024) {
+        sink = std::move(newSink);
+        chunkSize = newChunkSize > 0 ? newChunkSize : 1;
+        buffer.reserve(chunkSize + 8);
+    }
 
     // adds a bit to the BitWriters internal state.
     void write(bool bitValue) {
-        // Write to the current bit position (starting from MSB, position 7)
-        if (bitValue) {
-            currentByte |= (1 << currentBitPosition);
+        // Bits collect in a 64-bit accumulator that is flushed a whole word at a time
+        accumulator = BitOrder::append(accumulator, accumulatorBits, bitValue ? 1 : 0, 1);
+        accumulatorBits++;
+        bitCount++;
+
+        if (accumulatorBits == 64) {
+            flushWord(accumulator);
+            accumulator = 0;
+            accumulatorBits = 0;
         }
+    }
 
-        bitCount++;
-        currentBitPosition--;
+    // adds the low n bits of value (0 <= n <= 64) in the writer's bit order (most significant
+    // first for MsbFirst), so writeBits(v, n) produces the same stream as n calls to write()
+    void writeBits(uint64_t value, unsigned n) {
+        if (n == 0) return;
+        if (n < 64) value &= ((uint64_t)1 << n) - 1;
+        bitCount += n;
+
+        unsigned free = 64 - accumulatorBits;
+        if (n < free) {
+            accumulator = BitOrder::append(accumulator, accumulatorBits, value, n);
+            accumulatorBits += n;
+            return;
+        }
 
-        // If we've filled a byte (all 8 bits written)
-        if (currentBitPosition < 0) {
-            buffer.push_back(currentByte);
-            currentByte = 0;
-            currentBitPosition = 7;
+        // Fill the accumulator up to a full word, flush it, and keep what is left over
+        flushWord(BitOrder::fill(accumulator, accumulatorBits, value, n));
+        accumulator = BitOrder::leftover(value, accumulatorBits, n);
+        accumulatorBits = n - free;
+    }
+
+    // adds whole bytes; when the writer is byte-aligned they are copied straight into the buffer
+    void writeBytes(const uint8_t* data, size_t size) {
+        if (accumulatorBits % 8 == 0) {
+            flushBytes();
+            buffer.insert(buffer.end(), data, data + size);
+            bitCount += size * 8;
+            if (sink && buffer.size() >= chunkSize) flushToSink();
+            return;
+        }
+
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            writeBits(BitOrder::loadWord(data + i), 64);
         }
+        for (; i < size; i++) {
+            writeBits(data[i], 8);
+        }
+    }
+
+    void writeBytes(const std::vector<uint8_t>& bytes) {
+        writeBytes(bytes.data(), bytes.size());
     }
 
-    // returns the number of bits written
-    // all of the bits that have been written are returned in out
+    // pads with zero bits up to the next byte boundary
+    void alignToByte() {
+        writeBits(0, (8 - accumulatorBits % 8) % 8);
+    }
+
+    // copies the bits the writer still holds into out and returns how many there are
+    // (all of the bits written, unless a sink or take() has already moved some out)
     size_t getData(std::vector<uint8_t>& out) {
+        settle();
         out = buffer;
+        return bitCount - flushedBytes * 8;
+    }
 
-        // If there are any remaining bits in the current byte, add it
-        if (currentBitPosition < 7) {
-            out.push_back(currentByte);
-        }
+    // the bits the writer still holds, without copying them
+    BitView view() {
+        settle();
+        return BitView{std::span<const uint8_t>(buffer), bitCount - flushedBytes * 8};
+    }
 
+    // moves every complete byte out of the writer; a partial last byte stays behind until it
+    // is completed or padded with alignToByte()
+    std::vector<uint8_t> take() {
+        dropTail();
+        flushBytes();
+        std::vector<uint8_t> bytes = std::move(buffer);
+        buffer.clear();
+        flushedBytes += bytes.size();
+        return bytes;
+    }
+
+    // pads to a byte boundary and hands everything left to the sink
+    // returns the number of bits written, including the padding
+    size_t finish() {
+        alignToByte();
+        flushBytes();
+        if (sink && !buffer.empty()) flushToSink();
         return bitCount;
     }
 
     // formats a vector<uint8_t> as a hexadecimal string
     // takes an optional delimiter value that is written after each byte
-    std::string toHexString(std::vector<uint8_t> bytes, const std::string& delim = "") {
-        std::stringstream ss;
-        for (size_t i = 0; i < bytes.size(); i++) {
-            ss << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
-               << static_cast<int>(bytes[i]);
-            if (!delim.empty() && i < bytes.size() - 1) {
-                ss << delim;
+    static std::string toHexString(const std::vector<uint8_t>& bytes, const std::string& delim = "") {
+        return toHexString(bytes.data(), bytes.size(), delim);
+    }
+
+    // the output is sized up front and filled two characters per byte from a 512-byte table
+    static std::string toHexString(const uint8_t* bytes, size_t size, const std::string& delim = "") {
+        if (size == 0) return std::string();
+        std::string out(size * 2 + (size - 1) * delim.size(), '\0');
+        char* dest = &out[0];
+        const char* pairs = hexPairs().data();
+        size_t i = 0;
+
+        if (delim.empty()) {
+#ifdef __SSSE3__
+            // 16 bytes at a time: split into nibbles, map each through a shuffle, interleave
+            const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                                 '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+            const __m128i lowNibble = _mm_set1_epi8(0x0F);
+            for (; i + 16 <= size; i += 16, dest += 32) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+                __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), lowNibble));
+                __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(v, lowNibble));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi8(high, low));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 16), _mm_unpackhi_epi8(high, low));
+            }
+#endif
+            for (; i < size; i++, dest += 2) {
+                std::memcpy(dest, pairs + 2 * bytes[i], 2);
+            }
+            return out;
+        }
+
+        if (delim.size() == 1) {
+            // The common case: write three characters per byte and drop the trailing delimiter
+            for (; i + 1 < size; i++, dest += 3) {
+                std::memcpy(dest, pairs + 2 * bytes[i], 2);
+                dest[2] = delim[0];
+            }
+            std::memcpy(dest, pairs + 2 * bytes[i], 2);
+            return out;
+        }
+
+        for (; i < size; i++) {
+            std::memcpy(dest, pairs + 2 * bytes[i], 2);
+            dest += 2;
+            if (i + 1 < size) {
+                std::memcpy(dest, delim.data(), delim.size());
+                dest += delim.size();
+            }
+        }
+        return out;
+    }
+
+    // parses what toHexString produced (either case of A-F accepted) into out
+    // returns false, leaving out empty, if hex is not pairs of digits separated by delim
+    static bool fromHexString(const std::string& hex, std::vector<uint8_t>& out, const std::string& delim = "") {
+        out.clear();
+        if (hex.empty()) return true;
+        size_t stride = 2 + delim.size();
+        if ((hex.size() + delim.size()) % stride != 0) return false;
+
+        const std::array<int8_t, 256>& values = hexValues();
+        size_t size = (hex.size() + delim.size()) / stride;
+        std::vector<uint8_t> bytes(size);
+        const char* src = hex.data();
+        int invalid = 0;
+        for (size_t i = 0; i < size; i++, src += stride) {
+            int high = values[(uint8_t)src[0]];
+            int low = values[(uint8_t)src[1]];
+            invalid |= high | low;
+            bytes[i] = (uint8_t)((high << 4) | low);
+            if (!delim.empty() && i + 1 < size && delim.compare(0, delim.size(), src + 2, delim.size()) != 0) {
+                return false;
             }
         }
-        return ss.str();
+        if (invalid < 0) return false;
+        out.swap(bytes);
+        return true;
     }
+
 private:
     std::vector<uint8_t> buffer;
-    uint8_t currentByte;
+    uint64_t accumulator;     // pending bits, right-aligned, arranged as BitOrder says
+    unsigned accumulatorBits; // number of pending bits, always less than 64
     size_t bitCount;
-    int currentBitPosition;
+    size_t flushedBytes;      // bytes already handed to the sink or taken
+    bool tailInBuffer;        // view() left a padded copy of the partial byte at the end of buffer
+    Sink sink;
+    size_t chunkSize;
+
+    // appends a full accumulator word to the buffer
+    void flushWord(uint64_t word) {
+        dropTail();
+        size_t end = buffer.size();
+        buffer.resize(end + 8);
+        BitOrder::storeWord(buffer.data() + end, word);
+        if (sink && buffer.size() >= chunkSize) flushToSink();
+    }
+
+    // moves the whole bytes out of the accumulator, leaving fewer than 8 bits in it
+    void flushBytes() {
+        dropTail();
+        while (accumulatorBits >= 8) {
+            buffer.push_back(BitOrder::takeByte(accumulator, accumulatorBits));
+            accumulatorBits -= 8;
+        }
+        if (sink && buffer.size() >= chunkSize) flushToSink();
+    }
+
+    // brings the buffer up to date, ending with the partial byte if there is one
+    void settle() {
+        flushBytes();
+        if (accumulatorBits > 0) {
+            buffer.push_back(BitOrder::partialByte(accumulator, accumulatorBits));
+            tailInBuffer = true;
+        }
+    }
+
+    void dropTail() {
+        if (tailInBuffer) {
+            buffer.pop_back();
+            tailInBuffer = false;
+        }
+    }
+
+    void flushToSink() {
+        sink(buffer.data(), buffer.size());
+        flushedBytes += buffer.size();
+        buffer.clear();
+    }
+
+    // "000102...FF": the two hex digits of byte b start at index 2 * b
+    static const std::array<char, 512>& hexPairs() {
+        static constexpr std::array<char, 512> pairs = [] {
+            std::array<char, 512> table{};
+            const char digits[] = "0123456789ABCDEF";
+            for (int b = 0; b < 256; b++) {
+                table[2 * b] = digits[b >> 4];
+                table[2 * b + 1] = digits[b & 0x0F];
+            }
+            return table;
+        }();
+        return pairs;
+    }
+
+    // the value of each hex digit character, -1 for anything else
+    static const std::array<int8_t, 256>& hexValues() {
+        static constexpr std::array<int8_t, 256> values = [] {
+            std::array<int8_t, 256> table{};
+            for (int c = 0; c < 256; c++) {
+                table[c] = c >= '0' && c <= '9' ? c - '0'
+                         : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                         : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+            }
+            return table;
+        }();
+        return values;
+    }
 };
 
+// the original MSB-first writer
+using BitWriter = BasicBitWriter<MsbFirst>;
+using LsbBitWriter = BasicBitWriter<LsbFirst>;
+
 #endif //BITWRITER_H
\ No newline at end of file
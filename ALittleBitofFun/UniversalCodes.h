@@ -0,0 +1,151 @@
+#ifndef UNIVERSALCODES_H
+#define UNIVERSALCODES_H
+
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include "BitWriter.h"
+#include "BitReader.h"
+
+// variable-length integer codes on top of BitWriter / BitReader
+//
+//   Elias-gamma     v >= 1: bit_width(v) - 1 zeros, then v
+//   Elias-delta     v >= 1: bit_width(v) in gamma, then v without its leading 1
+//   Exp-Golomb k    v >= 0: gamma of v + 2^k with the first k zeros left out (k = 0 is gamma of v + 1)
+//   Rice k          v >= 0: v >> k in unary (that many zeros, then a 1), then the low k bits of v
+//   LEB128          v >= 0: 7 bits per byte, least significant group first, high bit set on all
+//                   but the last byte; byte-aligned when the stream is
+//
+// Lengths come from std::bit_width (a count-leading-zeros instruction) on the way out, and
+// runs of zeros are counted the same way on the way in, so every code is a handful of
+// writeBits / readBits calls rather than a loop over bits. Readers throw std::out_of_range
+// on a truncated stream, like BitReader itself.
+
+// maps signed deltas to unsigned so small magnitudes of either sign get short codes:
+// 0, -1, 1, -2, 2, ... become 0, 1, 2, 3, 4, ...
+inline uint64_t zigzagEncode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// writes n zero bits, any n
+inline void writeZeros(BitWriter& writer, uint64_t n) {
+    for (; n > 64; n -= 64) writer.writeBits(0, 64);
+    writer.writeBits(0, (unsigned)n);
+}
+
+// consumes zero bits up to (not including) the next 1 and returns how many there were
+inline uint64_t readZeros(BitReader& reader) {
+    uint64_t zeros = 0;
+    while (true) {
+        unsigned n = (unsigned)std::min<size_t>(56, reader.remaining());
+        if (n == 0) throw std::out_of_range("BitReader: unterminated run of zeros");
+        uint64_t bits = reader.peekBits(n);
+        if (bits != 0) {
+            unsigned run = n - (unsigned)std::bit_width(bits);
+            reader.skipBits(run);
+            return zeros + run;
+        }
+        reader.skipBits(n);
+        zeros += n;
+    }
+}
+
+inline void writeEliasGamma(BitWriter& writer, uint64_t value) {
+    if (value == 0) throw std::invalid_argument("Elias-gamma codes start at 1");
+    unsigned width = (unsigned)std::bit_width(value);
+    if (width <= 32) {
+        writer.writeBits(value, 2 * width - 1);
+    } else {
+        writer.writeBits(0, width - 1);
+        writer.writeBits(value, width);
+    }
+}
+
+inline uint64_t readEliasGamma(BitReader& reader) {
+    uint64_t zeros = readZeros(reader);
+    if (zeros > 63) throw std::out_of_range("Elias-gamma code longer than 64 bits");
+    return reader.readBits((unsigned)zeros + 1);
+}
+
+inline void writeEliasDelta(BitWriter& writer, uint64_t value) {
+    if (value == 0) throw std::invalid_argument("Elias-delta codes start at 1");
+    unsigned width = (unsigned)std::bit_width(value);
+    writeEliasGamma(writer, width);
+    writer.writeBits(value, width - 1);
+}
+
+inline uint64_t readEliasDelta(BitReader& reader) {
+    uint64_t width = readEliasGamma(reader);
+    if (width > 64) throw std::out_of_range("Elias-delta code longer than 64 bits");
+    uint64_t low = reader.readBits((unsigned)width - 1);
+    return width == 64 ? ((uint64_t)1 << 63) | low : ((uint64_t)1 << (width - 1)) | low;
+}
+
+// k <= 63 and value must be below 2^64 - 2^k, so that value + 2^k fits in 64 bits
+inline void writeExpGolomb(BitWriter& writer, uint64_t value, unsigned k) {
+    if (k > 63) throw std::invalid_argument("Exp-Golomb k must be at most 63");
+    if (value > ~(uint64_t)0 - ((uint64_t)1 << k)) throw std::invalid_argument("Exp-Golomb value too large for k");
+    uint64_t shifted = value + ((uint64_t)1 << k);
+    unsigned width = (unsigned)std::bit_width(shifted);
+    unsigned zeros = width - 1 - k;
+    if (zeros + width <= 64) {
+        writer.writeBits(shifted, zeros + width);
+    } else {
+        writer.writeBits(0, zeros);
+        writer.writeBits(shifted, width);
+    }
+}
+
+inline uint64_t readExpGolomb(BitReader& reader, unsigned k) {
+    if (k > 63) throw std::invalid_argument("Exp-Golomb k must be at most 63");
+    uint64_t zeros = readZeros(reader);
+    if (zeros + k > 63) throw std::out_of_range("Exp-Golomb code longer than 64 bits");
+    return reader.readBits((unsigned)(zeros + k) + 1) - ((uint64_t)1 << k);
+}
+
+// k <= 64; the quotient is written in unary, so k should keep value >> k small
+inline void writeRice(BitWriter& writer, uint64_t value, unsigned k) {
+    uint64_t quotient = k < 64 ? value >> k : 0;
+    if (quotient < 64 && quotient + 1 + k <= 64) {
+        // zeros, the terminating 1 and the remainder in one call
+        uint64_t remainder = k == 0 ? 0 : value & (~(uint64_t)0 >> (64 - k));
+        writer.writeBits(((uint64_t)1 << k) | remainder, (unsigned)(quotient + 1 + k));
+        return;
+    }
+    writeZeros(writer, quotient);
+    writer.write(1);
+    writer.writeBits(value, k);
+}
+
+inline uint64_t readRice(BitReader& reader, unsigned k) {
+    uint64_t quotient = readZeros(reader);
+    reader.skipBits(1);
+    uint64_t remainder = reader.readBits(k);
+    return k < 64 ? (quotient << k) | remainder : remainder;
+}
+
+inline void writeLeb128(BitWriter& writer, uint64_t value) {
+    while (value >= 0x80) {
+        writer.writeBits((value & 0x7F) | 0x80, 8);
+        value >>= 7;
+    }
+    writer.writeBits(value, 8);
+}
+
+inline uint64_t readLeb128(BitReader& reader) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        uint64_t byte = reader.readBits(8);
+        // the tenth byte holds bit 63 alone; anything more would not fit
+        if (shift == 63 && byte > 1) throw std::out_of_range("LEB128 value longer than 64 bits");
+        value |= (byte & 0x7F) << shift;
+        if (byte < 0x80) return value;
+    }
+    throw std::out_of_range("LEB128 value longer than 64 bits");
+}
+
+#endif //UNIVERSALCODES_H
@@ -1,7 +1,15 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <chrono>
+#include <stdexcept>
 #include "BitWriter.h"
+#include "BitReader.h"
+#include "UniversalCodes.h"
+#include "BitPacking.h"
 
 using namespace std;
 
@@ -169,5 +177,449 @@ int main() {
     cout << "  Expected: CC :: 33" << endl;
     cout << "  PASS: " << (hexStr10 == "CC :: 33" ? "YES" : "NO") << endl << endl;
 
+    // Test 11: Multi-bit writes match single-bit writes
+    cout << "Test 11: writeBits of mixed widths (1 to 64 bits) vs write()" << endl;
+    BitWriter bw11, bw11Bits;
+    uint64_t value11 = 0x9E3779B97F4A7C15ULL;
+    for (unsigned n = 0; n <= 64; n++) {
+        bw11.writeBits(value11, n);
+        for (int i = (int)n - 1; i >= 0; i--) {
+            bw11Bits.write((value11 >> i) & 1);
+        }
+        value11 = value11 * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+
+    vector<uint8_t> result11, expected11;
+    size_t bitCount11 = bw11.getData(result11);
+    size_t expectedCount11 = bw11Bits.getData(expected11);
+
+    cout << "  Bits written: " << bitCount11 << endl;
+    cout << "  Expected: " << expectedCount11 << " bits, identical bytes" << endl;
+    cout << "  PASS: " << (bitCount11 == 2080 && bitCount11 == expectedCount11 && result11 == expected11 ? "YES" : "NO")
+         << endl << endl;
+
+    // Test 12: Byte runs, aligned and unaligned
+    cout << "Test 12: writeBytes after 8 bits and after 4 bits" << endl;
+    vector<uint8_t> bytes12 = {0xDE, 0xAD, 0xBE, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89};
+    BitWriter bw12Aligned, bw12Unaligned;
+    bw12Aligned.writeBits(0xA5, 8);
+    bw12Aligned.writeBytes(bytes12);
+    bw12Unaligned.writeBits(0xA, 4);
+    bw12Unaligned.writeBytes(bytes12);
+
+    vector<uint8_t> result12Aligned, result12Unaligned;
+    size_t bitCount12 = bw12Aligned.getData(result12Aligned) + bw12Unaligned.getData(result12Unaligned);
+    string hexStr12Aligned = bw12Aligned.toHexString(result12Aligned);
+    string hexStr12Unaligned = bw12Unaligned.toHexString(result12Unaligned);
+
+    cout << "  Bits written: " << bitCount12 << endl;
+    cout << "  Hex output: " << hexStr12Aligned << ", " << hexStr12Unaligned << endl;
+    cout << "  Expected: A5DEADBEEF0123456789, ADEADBEEF01234567890" << endl;
+    cout << "  PASS: " << (bitCount12 == 156 && hexStr12Aligned == "A5DEADBEEF0123456789"
+                           && hexStr12Unaligned == "ADEADBEEF01234567890" ? "YES" : "NO") << endl << endl;
+
+    // Test 13: View and take without copying
+    cout << "Test 13: view() after 12 bits, more writes, then take()" << endl;
+    BitWriter bw13;
+    bw13.writeBits(0xABC, 12);
+    BitView view13 = bw13.view();
+    string hexStr13View = bw13.toHexString(vector<uint8_t>(view13.bytes.begin(), view13.bytes.end()));
+    size_t viewBits13 = view13.bitCount;
+    bw13.writeBits(0xD, 4);
+    bw13.write(1);
+    vector<uint8_t> taken13 = bw13.take();
+    string hexStr13Taken = bw13.toHexString(taken13);
+    vector<uint8_t> held13;
+    size_t heldBits13 = bw13.getData(held13);
+    size_t bitCount13 = bw13.finish();
+    BitView rest13 = bw13.view();
+    string hexStr13Rest = bw13.toHexString(vector<uint8_t>(rest13.bytes.begin(), rest13.bytes.end()));
+
+    cout << "  Hex output: " << hexStr13View << " (" << viewBits13 << " bits), " << hexStr13Taken << ", "
+         << hexStr13Rest << " (" << rest13.bitCount << " bits)" << endl;
+    cout << "  Expected: ABC0 (12 bits), ABCD, 80 (8 bits)" << endl;
+    cout << "  PASS: " << (hexStr13View == "ABC0" && viewBits13 == 12 && hexStr13Taken == "ABCD"
+                           && hexStr13Rest == "80" && rest13.bitCount == 8 && bitCount13 == 24
+                           && heldBits13 == 1 && held13 == vector<uint8_t>{0x80} ? "YES" : "NO")
+         << endl << endl;
+
+    // Test 14: Sinks receive the same bytes as getData
+    cout << "Test 14: ostream and fd sinks with 16-byte chunks" << endl;
+    BitWriter bw14, bw14Stream, bw14Fd;
+    stringstream stream14;
+    FILE* file14 = tmpfile();
+    bw14Stream.setSink(BitWriter::ostreamSink(stream14), 16);
+    bw14Fd.setSink(BitWriter::fdSink(fileno(file14)), 16);
+    size_t maxHeld14 = 0;
+    for (unsigned i = 0; i < 1000; i++) {
+        for (BitWriter* writer : {&bw14, &bw14Stream, &bw14Fd}) {
+            writer->writeBits(i * 2654435761u, 1 + i % 32);
+        }
+        maxHeld14 = max(maxHeld14, bw14Stream.view().bytes.size());
+    }
+    bw14.alignToByte();
+    vector<uint8_t> expected14;
+    bw14.getData(expected14);
+    size_t bitCount14 = bw14Stream.finish();
+    bw14Fd.finish();
+
+    string streamed14 = stream14.str();
+    vector<uint8_t> fromFd14(expected14.size() + 1);
+    rewind(file14);
+    size_t fdBytes14 = fread(fromFd14.data(), 1, fromFd14.size(), file14);
+    fromFd14.resize(fdBytes14);
+    fclose(file14);
+
+    cout << "  Bits written: " << bitCount14 << ", most bytes held: " << maxHeld14 << endl;
+    cout << "  Expected: " << expected14.size() << " identical bytes from each sink, at most 24 held" << endl;
+    cout << "  PASS: " << (vector<uint8_t>(streamed14.begin(), streamed14.end()) == expected14 && fromFd14 == expected14
+                           && bitCount14 == expected14.size() * 8 && maxHeld14 <= 24 ? "YES" : "NO") << endl << endl;
+
+    // Test 15: Reading back what BitWriter wrote
+    cout << "Test 15: BitReader round trip (bits, fields, alignment, bytes, bounds)" << endl;
+    BitWriter bw15;
+    bw15.write(1); bw15.write(0); bw15.write(1);
+    uint64_t value15 = 0x0123456789ABCDEFULL;
+    for (unsigned n = 0; n <= 64; n++) {
+        bw15.writeBits(n == 0 ? 0 : value15 >> (64 - n), n);
+    }
+    bw15.alignToByte();
+    bw15.writeBytes(bytes12);
+    bw15.writeBits(0x5, 3);
+
+    BitReader br15(bw15.view());
+    bool ok15 = br15.readBit() && !br15.readBit() && br15.peekBits(1) == 1 && br15.readBit();
+    for (unsigned n = 0; n <= 64; n++) {
+        ok15 &= br15.readBits(n) == (n == 0 ? 0 : value15 >> (64 - n));
+    }
+    br15.alignToByte();
+    vector<uint8_t> readBack15(bytes12.size());
+    br15.readBytes(readBack15.data(), readBack15.size());
+    ok15 &= readBack15 == bytes12 && br15.remaining() == 3 && br15.readBits(3) == 0x5 && br15.atEnd();
+    bool threw15 = false;
+    try {
+        br15.readBit();
+    } catch (const out_of_range&) {
+        threw15 = true;
+    }
+
+    cout << "  Bits read: " << br15.position() << " of " << br15.size() << endl;
+    cout << "  Expected: every field matches, reading past the end throws" << endl;
+    cout << "  PASS: " << (ok15 && threw15 && br15.position() == bw15.view().bitCount ? "YES" : "NO") << endl << endl;
+
+    // Test 16: Round-trip throughput
+    cout << "Test 16: Round trip of 4M random 1-32 bit fields" << endl;
+    const size_t fields16 = 4000000;
+    vector<uint32_t> values16(fields16);
+    vector<uint8_t> widths16(fields16);
+    uint64_t state16 = 343;
+    for (size_t i = 0; i < fields16; i++) {
+        state16 = state16 * 6364136223846793005ULL + 1442695040888963407ULL;
+        widths16[i] = (uint8_t)(1 + (state16 >> 59));
+        values16[i] = (uint32_t)(state16 >> 16) & (uint32_t)((1ULL << widths16[i]) - 1);
+    }
+
+    auto start16 = chrono::steady_clock::now();
+    BitWriter bw16;
+    for (size_t i = 0; i < fields16; i++) bw16.writeBits(values16[i], widths16[i]);
+    BitView view16 = bw16.view();
+    auto written16 = chrono::steady_clock::now();
+    BitReader br16(view16);
+    bool ok16 = true;
+    for (size_t i = 0; i < fields16; i++) ok16 &= br16.readBits(widths16[i]) == values16[i];
+    auto read16 = chrono::steady_clock::now();
+
+    double bits16 = (double)view16.bitCount;
+    double writeSeconds16 = chrono::duration<double>(written16 - start16).count();
+    double readSeconds16 = chrono::duration<double>(read16 - written16).count();
+    cout << "  Write: " << bits16 / writeSeconds16 / 1e9 << " Gbit/s, read: " << bits16 / readSeconds16 / 1e9
+         << " Gbit/s, round trip: " << bits16 / (writeSeconds16 + readSeconds16) / 1e9 << " Gbit/s" << endl;
+    cout << "  Expected: every field read back" << endl;
+    cout << "  PASS: " << (ok16 && br16.atEnd() ? "YES" : "NO") << endl << endl;
+
+    // Test 17: Table-driven hex against the stream formatting it replaced
+    cout << "Test 17: toHexString/fromHexString on 0-100 bytes with three delimiters" << endl;
+    auto streamHex17 = [](const vector<uint8_t>& bytes, const string& delim) {
+        stringstream ss;
+        for (size_t i = 0; i < bytes.size(); i++) {
+            ss << uppercase << hex << setw(2) << setfill('0') << static_cast<int>(bytes[i]);
+            if (!delim.empty() && i < bytes.size() - 1) ss << delim;
+        }
+        return ss.str();
+    };
+    bool ok17 = true;
+    vector<uint8_t> bytes17;
+    for (int size = 0; size <= 100; size++) {
+        for (const string& delim : {string(), string(":"), string(" :: ")}) {
+            string hexStr17 = BitWriter::toHexString(bytes17, delim);
+            vector<uint8_t> decoded17;
+            ok17 &= hexStr17 == streamHex17(bytes17, delim) && BitWriter::fromHexString(hexStr17, decoded17, delim)
+                    && decoded17 == bytes17;
+        }
+        bytes17.push_back((uint8_t)(size * 37 + 11));
+    }
+    vector<uint8_t> decoded17;
+    bool lowerCase17 = BitWriter::fromHexString("deadbeef", decoded17) && decoded17 == vector<uint8_t>{0xDE, 0xAD, 0xBE, 0xEF};
+    bool rejected17 = !BitWriter::fromHexString("G0", decoded17) && !BitWriter::fromHexString("ABC", decoded17)
+                      && !BitWriter::fromHexString("AB-CD", decoded17, ":") && !BitWriter::fromHexString("AB:", decoded17, ":")
+                      && decoded17.empty();
+
+    cout << "  Expected: same strings as stringstream, bytes round trip, lower case accepted, bad input rejected" << endl;
+    cout << "  PASS: " << (ok17 && lowerCase17 && rejected17 ? "YES" : "NO") << endl << endl;
+
+    // Test 18: Hex throughput
+    cout << "Test 18: Hex encoding 4 MB" << endl;
+    vector<uint8_t> bytes18(4 << 20);
+    for (size_t i = 0; i < bytes18.size(); i++) bytes18[i] = (uint8_t)(i * 2654435761u >> 13);
+    auto start18 = chrono::steady_clock::now();
+    string table18 = BitWriter::toHexString(bytes18);
+    auto table18Done = chrono::steady_clock::now();
+    string delimited18 = BitWriter::toHexString(bytes18, " ");
+    auto delimited18Done = chrono::steady_clock::now();
+    string stream18 = streamHex17(bytes18, "");
+    auto stream18Done = chrono::steady_clock::now();
+    vector<uint8_t> decoded18;
+    bool ok18 = BitWriter::fromHexString(table18, decoded18) && decoded18 == bytes18;
+    auto decoded18Done = chrono::steady_clock::now();
+
+    double megabytes18 = bytes18.size() / 1e6;
+    cout << "  Table: " << megabytes18 / chrono::duration<double>(table18Done - start18).count() << " MB/s, with delimiter: "
+         << megabytes18 / chrono::duration<double>(delimited18Done - table18Done).count() << " MB/s, stringstream: "
+         << megabytes18 / chrono::duration<double>(stream18Done - delimited18Done).count() << " MB/s, decode: "
+         << megabytes18 / chrono::duration<double>(decoded18Done - stream18Done).count() << " MB/s" << endl;
+    cout << "  Expected: same output as stringstream, decodes back" << endl;
+    cout << "  PASS: " << (ok18 && table18 == stream18 ? "YES" : "NO") << endl << endl;
+
+    // Test 19: Universal codes round trip
+    cout << "Test 19: Elias-gamma/delta, Exp-Golomb, Rice and LEB128 round trips" << endl;
+    vector<uint64_t> values19 = {1, 2, 3, 4, 5, 7, 8, 100, 255, 256, 65535, 1ULL << 31, (1ULL << 32) - 1,
+                                 1ULL << 32, 0x123456789ABCDEFULL, (1ULL << 63) - 1, 1ULL << 63, ~0ULL};
+    BitWriter bw19;
+    for (uint64_t v : values19) {
+        writeEliasGamma(bw19, v);
+        writeEliasDelta(bw19, v);
+        writeExpGolomb(bw19, v - 1, 0);
+        writeExpGolomb(bw19, v >> 4, 5);
+        writeRice(bw19, v & 0xFFFF, 6);
+        writeLeb128(bw19, v);
+        bw19.writeBits(zigzagEncode(-(int64_t)(v >> 1)), 64);
+    }
+    writeRice(bw19, 1000, 0);
+    BitReader br19(bw19.view());
+    bool ok19 = true;
+    for (uint64_t v : values19) {
+        ok19 &= readEliasGamma(br19) == v;
+        ok19 &= readEliasDelta(br19) == v;
+        ok19 &= readExpGolomb(br19, 0) == v - 1;
+        ok19 &= readExpGolomb(br19, 5) == v >> 4;
+        ok19 &= readRice(br19, 6) == (v & 0xFFFF);
+        ok19 &= readLeb128(br19) == v;
+        ok19 &= zigzagDecode(br19.readBits(64)) == -(int64_t)(v >> 1);
+    }
+    ok19 &= readRice(br19, 0) == 1000 && br19.atEnd();
+
+    // Known encodings: gamma(5) = 00101, delta(5) = 011 01, Exp-Golomb k=1 of 3 = 0101, LEB128(300) = AC 02
+    BitWriter bw19Known;
+    writeEliasGamma(bw19Known, 5);
+    writeEliasDelta(bw19Known, 5);
+    writeExpGolomb(bw19Known, 3, 1);
+    bw19Known.alignToByte();
+    writeLeb128(bw19Known, 300);
+    vector<uint8_t> known19;
+    bw19Known.getData(known19);
+    string hexStr19 = BitWriter::toHexString(known19);
+
+    bool truncated19 = false;
+    vector<uint8_t> zeros19(4, 0);
+    BitReader br19Zeros(zeros19, 32);
+    try {
+        readEliasGamma(br19Zeros);
+    } catch (const out_of_range&) {
+        truncated19 = true;
+    }
+
+    // k = 63 is the widest Exp-Golomb code; k = 64 would shift by 64 and is rejected
+    BitWriter bw19Wide;
+    writeExpGolomb(bw19Wide, (1ULL << 63) - 1, 63);
+    BitReader br19Wide(bw19Wide.view());
+    bool bounds19 = readExpGolomb(br19Wide, 63) == (1ULL << 63) - 1;
+    try {
+        writeExpGolomb(bw19Wide, 0, 64);
+        bounds19 = false;
+    } catch (const invalid_argument&) {
+    }
+
+    // Ten LEB128 bytes whose last one carries bits past bit 63
+    vector<uint8_t> leb19(10, 0xFF);
+    leb19[9] = 0x02;
+    BitReader br19Leb(leb19, 80);
+    try {
+        readLeb128(br19Leb);
+        bounds19 = false;
+    } catch (const out_of_range&) {
+    }
+
+    cout << "  Hex output: " << hexStr19 << endl;
+    cout << "  Expected: 2B54AC02, every value read back, truncated code and out-of-range k or LEB128 throw" << endl;
+    cout << "  PASS: " << (ok19 && hexStr19 == "2B54AC02" && truncated19 && bounds19 ? "YES" : "NO") << endl << endl;
+
+    // Test 20: Universal code throughput on small deltas
+    cout << "Test 20: Coding 4M zigzag deltas of a timestamp column" << endl;
+    const size_t count20 = 4000000;
+    vector<uint64_t> deltas20(count20);
+    uint64_t state20 = 343;
+    for (size_t i = 0; i < count20; i++) {
+        state20 = state20 * 6364136223846793005ULL + 1442695040888963407ULL;
+        deltas20[i] = zigzagEncode((int64_t)(state20 >> 54) - 512);
+    }
+    bool ok20 = true;
+    auto runCode20 = [&](const char* name, auto writeValue, auto readValue) {
+        auto start = chrono::steady_clock::now();
+        BitWriter writer;
+        for (uint64_t d : deltas20) writeValue(writer, d);
+        BitView view = writer.view();
+        auto written = chrono::steady_clock::now();
+        BitReader reader(view);
+        for (uint64_t d : deltas20) ok20 &= readValue(reader) == d;
+        auto read = chrono::steady_clock::now();
+        cout << "  " << name << ": " << (double)view.bitCount / count20 << " bits/int, write "
+             << count20 / chrono::duration<double>(written - start).count() / 1e6 << " M ints/s, read "
+             << count20 / chrono::duration<double>(read - written).count() / 1e6 << " M ints/s" << endl;
+    };
+    runCode20("Elias-gamma", [](BitWriter& w, uint64_t v) { writeEliasGamma(w, v + 1); },
+              [](BitReader& r) { return readEliasGamma(r) - 1; });
+    runCode20("Elias-delta", [](BitWriter& w, uint64_t v) { writeEliasDelta(w, v + 1); },
+              [](BitReader& r) { return readEliasDelta(r) - 1; });
+    runCode20("Exp-Golomb k=8", [](BitWriter& w, uint64_t v) { writeExpGolomb(w, v, 8); },
+              [](BitReader& r) { return readExpGolomb(r, 8); });
+    runCode20("Rice k=9", [](BitWriter& w, uint64_t v) { writeRice(w, v, 9); },
+              [](BitReader& r) { return readRice(r, 9); });
+    runCode20("LEB128", [](BitWriter& w, uint64_t v) { writeLeb128(w, v); },
+              [](BitReader& r) { return readLeb128(r); });
+    cout << "  Expected: every value read back" << endl;
+    cout << "  PASS: " << (ok20 ? "YES" : "NO") << endl << endl;
+
+    // Test 21: Frame-of-reference bit packing round trip
+    cout << "Test 21: packArray/unpackArray on constant, sorted, full-range and partial blocks" << endl;
+    vector<uint32_t> values21;
+    for (int i = 0; i < 128; i++) values21.push_back(7);                        // width 0
+    for (int i = 0; i < 128; i++) values21.push_back(1000000 + i * 3);          // width 9
+    for (int i = 0; i < 128; i++) values21.push_back(i % 2 ? 0xFFFFFFFFu : 0);  // width 32
+    for (int i = 0; i < 44; i++) values21.push_back(500 + i * i);               // partial block
+    BitWriter bw21;
+    bw21.write(1); // packArray starts mid-byte
+    packArray(bw21, values21);
+    BitReader br21(bw21.view());
+    br21.readBit();
+    vector<uint32_t> unpacked21;
+    unpackArray(br21, unpacked21);
+
+    vector<uint8_t> data21;
+    bw21.getData(data21);
+    data21.resize(data21.size() - 10);
+    BitReader br21Truncated(data21, data21.size() * 8);
+    br21Truncated.readBit();
+    bool truncated21 = false;
+    try {
+        vector<uint32_t> partial21;
+        unpackArray(br21Truncated, partial21);
+    } catch (const out_of_range&) {
+        truncated21 = true;
+    }
+
+    // A count of 2^64 - 1 must not round up to zero blocks and slip past the length check
+    BitWriter bw21Huge;
+    writeLeb128(bw21Huge, ~(uint64_t)0);
+    packArray(bw21Huge, values21);
+    BitReader br21Huge(bw21Huge.view());
+    bool huge21 = false;
+    try {
+        vector<uint32_t> partial21;
+        unpackArray(br21Huge, partial21);
+    } catch (const out_of_range&) {
+        huge21 = true;
+    }
+
+    // 1 + 7 padding bits, 2 bytes of count, then blocks of 5, 5 + 16 * 9, 5 + 16 * 32, 5 + 16 * 11 bytes
+    cout << "  Bits written: " << bw21.view().bitCount << endl;
+    cout << "  Expected: " << 8 * (1 + 2 + 5 + 149 + 517 + 181) << ", every value read back, truncated stream and huge count throw" << endl;
+    cout << "  PASS: " << (unpacked21 == values21 && br21.atEnd() && truncated21 && huge21
+                           && bw21.view().bitCount == 8 * (1 + 2 + 5 + 149 + 517 + 181) ? "YES" : "NO") << endl << endl;
+
+    // Test 22: Bit packing throughput on sorted IDs
+    cout << "Test 22: Packing 16M sorted IDs (gaps of 0-63)" << endl;
+    const size_t count22 = 16 << 20;
+    vector<uint32_t> ids22(count22);
+    uint64_t state22 = 343;
+    uint32_t id22 = 0;
+    for (size_t i = 0; i < count22; i++) {
+        state22 = state22 * 6364136223846793005ULL + 1442695040888963407ULL;
+        id22 += (uint32_t)(state22 >> 58);
+        ids22[i] = id22;
+    }
+    auto start22 = chrono::steady_clock::now();
+    BitWriter bw22;
+    packArray(bw22, ids22);
+    BitView view22 = bw22.view();
+    auto packed22 = chrono::steady_clock::now();
+    BitReader br22(view22);
+    vector<uint32_t> unpacked22;
+    unpackArray(br22, unpacked22);
+    auto unpacked22Done = chrono::steady_clock::now();
+
+    double megabytes22 = count22 * 4 / 1e6;
+    cout << "  " << (double)view22.bitCount / count22 << " bits/int, pack "
+         << megabytes22 / chrono::duration<double>(packed22 - start22).count() << " MB/s, unpack "
+         << megabytes22 / chrono::duration<double>(unpacked22Done - packed22).count() << " MB/s" << endl;
+    cout << "  Expected: every ID read back" << endl;
+    cout << "  PASS: " << (unpacked22 == ids22 ? "YES" : "NO") << endl << endl;
+
+    // Test 23: LSB-first bit order
+    cout << "Test 23: LsbBitWriter (DEFLATE order): header bits, little-endian field, writeBits vs write()" << endl;
+    LsbBitWriter bw23;
+    bw23.write(1);          // BFINAL
+    bw23.writeBits(1, 2);   // BTYPE = 01
+    bw23.alignToByte();
+    bw23.writeBits(0x1234, 16);
+    bw23.writeBits(0x5, 3);
+    vector<uint8_t> result23;
+    size_t bitCount23 = bw23.getData(result23);
+    string hexStr23 = LsbBitWriter::toHexString(result23, " ");
+
+    LsbBitWriter bw23Bits, bw23Words;
+    uint64_t value23 = 0x9E3779B97F4A7C15ULL;
+    for (unsigned n = 0; n <= 64; n++) {
+        bw23Words.writeBits(value23, n);
+        for (unsigned i = 0; i < n; i++) {
+            bw23Bits.write((value23 >> i) & 1);
+        }
+        value23 = value23 * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    bw23Words.writeBytes(bytes12);
+    for (uint8_t b : bytes12) bw23Bits.writeBits(b, 8);
+    vector<uint8_t> words23, bits23;
+    bool same23 = bw23Words.getData(words23) == bw23Bits.getData(bits23) && words23 == bits23;
+
+    cout << "  Bits written: " << bitCount23 << endl;
+    cout << "  Hex output: " << hexStr23 << endl;
+    cout << "  Expected: 03 34 12 05, identical streams" << endl;
+    cout << "  PASS: " << (hexStr23 == "03 34 12 05" && bitCount23 == 27 && same23 ? "YES" : "NO") << endl << endl;
+
+    // Test 24: Both orders at full speed
+    cout << "Test 24: 4M random 1-32 bit fields in each bit order" << endl;
+    auto writeFields24 = [&](auto& writer) {
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < fields16; i++) writer.writeBits(values16[i], widths16[i]);
+        size_t bits = writer.view().bitCount;
+        return bits / chrono::duration<double>(chrono::steady_clock::now() - start).count() / 1e9;
+    };
+    BitWriter bw24Msb;
+    LsbBitWriter bw24Lsb;
+    double msbRate24 = writeFields24(bw24Msb);
+    double lsbRate24 = writeFields24(bw24Lsb);
+    cout << "  MSB-first: " << msbRate24 << " Gbit/s, LSB-first: " << lsbRate24 << " Gbit/s" << endl;
+    cout << "  Expected: same number of bits" << endl;
+    cout << "  PASS: " << (bw24Msb.view().bitCount == bw24Lsb.view().bitCount ? "YES" : "NO") << endl << endl;
+
     return 0;
 }
\ No newline at end of file
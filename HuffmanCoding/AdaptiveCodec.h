@@ -0,0 +1,204 @@
+#ifndef ADAPTIVECODEC_H
+#define ADAPTIVECODEC_H
+
+#include "HuffmanTree.h"
+#include "HuffmanFile.h"
+#include "DecodeTable.h"
+#include "Frequency.h"
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Adaptive layout (all integers little-endian):
+//
+//   magic           4 bytes   "HUA1"
+//   original length 8 bytes
+//   block size      4 bytes
+//   per block:
+//     mode          1 byte    kAdaptiveReuse, kAdaptiveNewTable or kAdaptiveRaw
+//     table         new-table blocks only: flags byte + code lengths, as in HuffmanFile.h
+//     payload bits  8 bytes   coded blocks only
+//     payload       packed codes, or the block's bytes verbatim for raw blocks
+//   checksum        4 bytes   CRC-32 of the original data
+//
+// Each block is coded with whichever of the previous table, a fresh table, or no coding at
+// all is smallest. A fresh table is only built when the block's entropy suggests it could win,
+// so table-build cost is paid where the data drifts rather than on every block.
+
+const char kAdaptiveMagic[4] = {'H', 'U', 'A', '1'};
+const uint32_t kAdaptiveBlockSize = 1 << 16;
+
+enum AdaptiveMode : uint8_t { kAdaptiveReuse, kAdaptiveNewTable, kAdaptiveRaw };
+
+struct AdaptiveStats {
+    size_t reusedBlocks;
+    size_t newTableBlocks;
+    size_t rawBlocks;
+};
+
+/**
+ * Estimated size in bits of a block coded with the given code lengths, or UINT64_MAX if the
+ * block uses a character the lengths do not cover.
+ */
+inline uint64_t codedSizeBits(const Histogram& counts, const std::array<uint8_t, 256>& lengths) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] == 0) continue;
+        if (lengths[i] == 0) return UINT64_MAX;
+        bits += counts[i] * lengths[i];
+    }
+    return bits;
+}
+
+/**
+ * Size in bits of a coded block's payload-bits field and payload (padded to a whole byte),
+ * or UINT64_MAX for an uncodable block. The mode byte is the same for every choice and is
+ * left out.
+ */
+inline uint64_t storedCodedBits(uint64_t payloadBits) {
+    return payloadBits == UINT64_MAX ? UINT64_MAX : 64 + (payloadBits + 7) / 8 * 8;
+}
+
+/**
+ * Lower bound on the size in bits of a block coded with its own Huffman table (the order-0
+ * entropy, at least one bit per character), not counting the table itself.
+ */
+inline uint64_t entropyBits(const Histogram& counts, uint64_t total) {
+    double bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) {
+            bits += counts[i] * std::log2((double)total / counts[i]);
+        }
+    }
+    return std::max<uint64_t>((uint64_t)std::ceil(bits), total);
+}
+
+/**
+ * Compresses text block by block, choosing per block between the previous table, a new table
+ * and raw storage.
+ * @return How many blocks took each choice.
+ */
+inline AdaptiveStats compressAdaptive(const std::string& text, std::ostream& out,
+                                      uint32_t blockSize = kAdaptiveBlockSize) {
+    AdaptiveStats stats{0, 0, 0};
+    out.write(kAdaptiveMagic, 4);
+    writeLittleEndian(out, text.size(), 8);
+    writeLittleEndian(out, blockSize, 4);
+
+    HuffmanTree tree;
+    std::array<uint8_t, 256> lengths{};
+    bool haveTable = false;
+
+    for (size_t start = 0; start < text.size(); start += blockSize) {
+        size_t length = std::min<size_t>(blockSize, text.size() - start);
+        Histogram counts{};
+        addToHistogram(text.data() + start, length, counts);
+
+        // Each choice is costed as stored: raw bytes, or the payload-bits field and padded payload,
+        // plus the table for a new one. A fresh Huffman table rarely lands within 1.5% of the
+        // entropy, so only build one when the previous table is worse than that by more than the
+        // cost of storing the new one.
+        uint64_t rawBits = (uint64_t)length * 8;
+        uint64_t reuseBits = haveTable ? storedCodedBits(codedSizeBits(counts, lengths)) : UINT64_MAX;
+        uint64_t tableBits = 8 + 128 * 8;
+        uint64_t entropy = entropyBits(counts, length);
+        uint64_t newBits = storedCodedBits(entropy + entropy / 64) + tableBits;
+
+        AdaptiveMode mode = reuseBits < rawBits ? kAdaptiveReuse : kAdaptiveRaw;
+        if (newBits < std::min(reuseBits, rawBits)) {
+            HuffmanTree candidate;
+            candidate.buildTree(histogramToFrequencies(counts));
+            candidate.generateCanonicalCodes(kContainerMaxCodeLength);
+            std::array<uint8_t, 256> candidateLengths = candidate.getCanonicalCodeLengths();
+
+            // The estimate is only a guess; keep the cheaper option if the real table loses
+            if (storedCodedBits(codedSizeBits(counts, candidateLengths)) + tableBits < std::min(reuseBits, rawBits)) {
+                tree = std::move(candidate);
+                lengths = candidateLengths;
+                haveTable = true;
+                mode = kAdaptiveNewTable;
+            }
+        }
+
+        out.put((char)mode);
+        if (mode == kAdaptiveRaw) {
+            stats.rawBlocks++;
+            out.write(text.data() + start, (std::streamsize)length);
+            continue;
+        }
+        if (mode == kAdaptiveNewTable) {
+            stats.newTableBlocks++;
+            out.put((char)codeLengthFlags(lengths));
+            writeCodeLengths(out, lengths);
+        } else {
+            stats.reusedBlocks++;
+        }
+
+        BitSet bits;
+        tree.getCanonicalEncodeTable().encode(text.data() + start, length, bits);
+        const std::vector<uint8_t>& bytes = bits.getBytes();
+        writeLittleEndian(out, (uint64_t)bits.size(), 8);
+        out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+    }
+
+    writeLittleEndian(out, crc32Update(0, text.data(), text.size()), 4);
+    return stats;
+}
+
+/**
+ * Decompresses a stream written by compressAdaptive.
+ * @return false on a malformed stream or a checksum mismatch.
+ */
+inline bool decompressAdaptive(std::istream& in, std::string& out) {
+    out.clear();
+    char magic[4];
+    uint64_t length, blockSize;
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kAdaptiveMagic)
+        || !readLittleEndian(in, length, 8) || !readLittleEndian(in, blockSize, 4) || blockSize == 0) {
+        return false;
+    }
+
+    // Grown only as block data arrives, so a corrupt length or block size fails at end of input
+    // rather than allocating up front
+    std::string text;
+    DecodeTable table;
+    std::vector<uint8_t> bytes;
+
+    for (uint64_t start = 0; start < length; start += blockSize) {
+        size_t blockLength = (size_t)std::min<uint64_t>(blockSize, length - start);
+        int mode = in.get();
+
+        if (mode == kAdaptiveRaw) {
+            if (!readBytes(in, text, blockLength)) return false;
+            continue;
+        }
+        if (mode == kAdaptiveNewTable) {
+            std::array<uint8_t, 256> lengths;
+            int flags = in.get();
+            if (flags == EOF || !readCodeLengths(in, flags, lengths) || !table.build(lengths)) return false;
+        } else if (mode != kAdaptiveReuse || !table.isValid()) {
+            return false;
+        }
+
+        // Every code is at least one bit, so the payload read first backs the block's length
+        uint64_t numBits;
+        if (!readLittleEndian(in, numBits, 8) || numBits < blockLength
+            || numBits > (uint64_t)blockLength * DecodeTable::kMaxCodeLength) {
+            return false;
+        }
+        bytes.clear();
+        if (!readBytes(in, bytes, (numBits + 7) / 8)) return false;
+        text.resize((size_t)start + blockLength);
+        if (!table.decode(bytes.data(), 0, numBits, &text[start], blockLength)) return false;
+    }
+
+    uint64_t expected;
+    if (!readLittleEndian(in, expected, 4) || expected != crc32Update(0, text.data(), text.size())) {
+        return false;
+    }
+    out.swap(text);
+    return true;
+}
+
+#endif //ADAPTIVECODEC_H
@@ -0,0 +1,333 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include "BitSet.h"
+#include "HuffmanTree.h"
+#include "BlockCodec.h"
+#include "MultiStream.h"
+#include "StaticDictionary.h"
+#include "ContextCodec.h"
+#include "HuffmanFile.h"
+#include <sstream>
+#include "Corpus.h"
+
+using namespace std;
+
+// The original canonical decoder: grow a '0'/'1' string bit by bit and look it up in a map.
+// Kept here as the baseline the table decoder is measured against.
+string decodeWithStringMap(const map<char, BitSet>& canonicalCodes, const BitSet& encoded) {
+    map<string, char> reverseMap;
+    for (const auto& pair : canonicalCodes) {
+        reverseMap[pair.second.toBinaryString()] = pair.first;
+    }
+
+    string decoded = "";
+    string currentBits = "";
+    for (size_t i = 0; i < encoded.size(); i++) {
+        currentBits += encoded.getBit(i) ? '1' : '0';
+        auto it = reverseMap.find(currentBits);
+        if (it != reverseMap.end()) {
+            decoded += it->second;
+            currentBits = "";
+        }
+    }
+    return decoded;
+}
+
+// DecodeTable's range decode with its per-code checks taken out. Only safe on valid input;
+// kept to measure what validation costs.
+void decodeUnchecked(const DecodeTable& table, const uint8_t* data, size_t endBit, char* out, size_t numSymbols) {
+    size_t numBytes = (endBit + 7) / 8;
+    size_t nextByte = 0;
+    uint64_t window = 0;
+    int windowBits = 0;
+    for (size_t i = 0; i < numSymbols; i++) {
+        while (windowBits <= 56 && nextByte < numBytes) {
+            window |= (uint64_t)data[nextByte++] << (56 - windowBits);
+            windowBits += 8;
+        }
+        uint8_t symbol;
+        int len = table.decode(window, symbol);
+        out[i] = (char)symbol;
+        window <<= len;
+        windowBits -= len;
+    }
+}
+
+// The original frequency count: one std::map lookup per byte
+map<char, int> countWithMap(const string& text) {
+    map<char, int> frequencies;
+    for (char c : text) {
+        frequencies[c]++;
+    }
+    return frequencies;
+}
+
+template <typename Fn>
+double timeIt(Fn fn) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double>(end - start).count();
+}
+
+void report(const string& name, size_t bytes, double seconds, bool ok) {
+    cout << "  " << left << setw(22) << name << right << fixed << setprecision(1)
+         << setw(10) << (bytes / 1e6) / seconds << " MB/s"
+         << (ok ? "" : "   (MISMATCH)") << "\n";
+}
+
+// Parses sizes like "4096", "64K", "16M" or "1G" (powers of 1024)
+size_t parseSize(const char* arg) {
+    char* end;
+    size_t value = strtoull(arg, &end, 10);
+    switch (*end) {
+        case 'K': case 'k': return value << 10;
+        case 'M': case 'm': return value << 20;
+        case 'G': case 'g': return value << 30;
+    }
+    return value;
+}
+
+string formatSize(size_t bytes) {
+    if (bytes >= (1 << 30)) return to_string(bytes >> 30) + " GB";
+    if (bytes >= (1 << 20)) return to_string(bytes >> 20) + " MB";
+    if (bytes >= (1 << 10)) return to_string(bytes >> 10) + " KB";
+    return to_string(bytes) + " B";
+}
+
+// Nearest-rank percentile of an ascending list of run times
+double percentile(const vector<double>& sorted, double p) {
+    size_t rank = (size_t)ceil(p / 100 * sorted.size());
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+// Corpus sizes for runSuite: 16x steps from 1 KB, the last one clamped to maxSize so the
+// requested size always runs
+vector<size_t> suiteSizes(size_t maxSize) {
+    vector<size_t> sizes;
+    for (size_t size = 1 << 10; size < maxSize; size <<= 4) {
+        sizes.push_back(size);
+    }
+    if (maxSize > 0) sizes.push_back(maxSize);
+    return sizes;
+}
+
+// Table build, encode and decode over every corpus and size, repeated `runs` times.
+// Throughput is reported at the median and 90th-percentile (slow) run times.
+void runSuite(size_t maxSize, int runs) {
+    cout << left << setw(9) << "corpus" << right << setw(7) << "size"
+         << setw(12) << "build us"
+         << setw(18) << "encode MB/s"
+         << setw(18) << "decode MB/s"
+         << setw(8) << "ratio" << "\n";
+    cout << left << setw(9) << "" << right << setw(7) << "" << setw(12) << "p50"
+         << setw(18) << "p50 / p90" << setw(18) << "p50 / p90" << "\n";
+
+    for (CorpusKind kind : kAllCorpora) {
+        for (size_t size : suiteSizes(maxSize)) {
+            string text = makeCorpus(kind, size);
+            vector<double> buildTimes, encodeTimes, decodeTimes;
+            double ratio = 0;
+            bool ok = true;
+
+            for (int run = 0; run < runs; run++) {
+                HuffmanTree tree;
+                buildTimes.push_back(timeIt([&] {
+                    tree.buildTree(tree.countFrequencies(text));
+                    tree.generateCodes();
+                    tree.generateCanonicalCodes();
+                }));
+
+                BitSet encoded;
+                encodeTimes.push_back(timeIt([&] { encoded = tree.encodeText(text, true); }));
+                string decoded;
+                decodeTimes.push_back(timeIt([&] { decoded = tree.decodeText(encoded, true); }));
+
+                ratio = (double)encoded.size() / ((double)text.size() * 8);
+                ok = ok && decoded == text;
+            }
+            sort(buildTimes.begin(), buildTimes.end());
+            sort(encodeTimes.begin(), encodeTimes.end());
+            sort(decodeTimes.begin(), decodeTimes.end());
+
+            double mb = text.size() / 1e6;
+            cout << left << setw(9) << corpusName(kind) << right << setw(7) << formatSize(size)
+                 << fixed << setprecision(1)
+                 << setw(12) << percentile(buildTimes, 50) * 1e6
+                 << setw(10) << mb / percentile(encodeTimes, 50) << " / " << setw(5) << mb / percentile(encodeTimes, 90)
+                 << setw(10) << mb / percentile(decodeTimes, 50) << " / " << setw(5) << mb / percentile(decodeTimes, 90)
+                 << setprecision(4) << setw(8) << ratio
+                 << (ok ? "" : "   (MISMATCH)") << "\n";
+        }
+    }
+}
+
+// Old and new implementations side by side on one English corpus
+void runComparisons(size_t size) {
+    string text = makeCorpus(kCorpusEnglish, size);
+
+    cout << "Counting " << text.size() << " bytes\n";
+    map<char, int> frequencies;
+    double seconds = timeIt([&] { frequencies = countWithMap(text); });
+    report("std::map", text.size(), seconds, true);
+    seconds = timeIt([&] { frequencies = countFrequencies(text); });
+    report("histogram", text.size(), seconds, frequencies == countWithMap(text));
+    seconds = timeIt([&] { frequencies = countFrequencies(text, defaultThreadCount()); });
+    report("histogram x" + to_string(defaultThreadCount()), text.size(), seconds, true);
+
+    HuffmanTree tree;
+    tree.buildTree(frequencies);
+    tree.generateCodes();
+    tree.generateCanonicalCodes();
+
+    BitSet standard = tree.encodeText(text, false);
+    BitSet canonical;
+    seconds = timeIt([&] { canonical = tree.encodeText(text, true); });
+
+    cout << "Encoding " << text.size() << " bytes (" << canonical.size() << " bits)\n";
+    report("canonical encode", text.size(), seconds, canonical.size() == standard.size());
+
+    cout << "Decoding\n";
+
+    string decoded;
+    seconds = timeIt([&] { decoded = tree.decodeText(standard, false); });
+    report("tree walk", text.size(), seconds, decoded == text);
+
+    // The string-map path is slow enough that a 1 MB slice is plenty
+    string slice = text.substr(0, min(text.size(), (size_t)1000 * 1000));
+    BitSet sliceEncoded = tree.encodeText(slice, true);
+    seconds = timeIt([&] { decoded = decodeWithStringMap(tree.getCanonicalCodes(), sliceEncoded); });
+    report("string map", slice.size(), seconds, decoded == slice);
+
+    seconds = timeIt([&] { decoded = tree.decodeText(canonical, true); });
+    report("canonical table", text.size(), seconds, decoded == text);
+
+    // Best of several runs each, since the difference is small next to timing noise; the
+    // spread of the paired runs is printed too, since it is often as large as the overhead
+    cout << "Validation (15-bit codes, best of 5)\n";
+    BlockEncoded whole = compressBlocks(text, 1, (uint32_t)max<size_t>(text.size(), 1));
+    DecodeTable wholeTable(whole.codeLengths);
+    decoded.assign(text.size(), '\0');
+    double unchecked = 1e9, validated = 1e9;
+    vector<double> runOverheads;
+    bool validOk = true;
+    for (int run = 0; run < 5; run++) {
+        double uncheckedRun = timeIt([&] {
+            decodeUnchecked(wholeTable, whole.payload.data(), whole.payloadBits, &decoded[0], text.size());
+        });
+        double validatedRun = timeIt([&] {
+            validOk &= wholeTable.decode(whole.payload.data(), 0, whole.payloadBits, &decoded[0], text.size());
+        });
+        unchecked = min(unchecked, uncheckedRun);
+        validated = min(validated, validatedRun);
+        runOverheads.push_back((validatedRun / uncheckedRun - 1) * 100);
+    }
+    sort(runOverheads.begin(), runOverheads.end());
+    report("unchecked", text.size(), unchecked, decoded == text);
+    report("validated", text.size(), validated, validOk && decoded == text);
+    cout << "  validation overhead: " << setprecision(1) << (validated / unchecked - 1) * 100
+         << "% best of 5, " << runOverheads.front() << "% to " << runOverheads.back() << "% run to run\n";
+
+    // Same 15-bit table both ways; only the number of interleaved bitstreams differs
+    cout << "Interleaved streams (15-bit codes)\n";
+    BlockEncoded single = compressBlocks(text, 1, (uint32_t)max<size_t>(text.size(), 1));
+    DecodeTable limitedTable;
+    limitedTable.build(single.codeLengths);
+    decoded.assign(text.size(), '\0');
+    seconds = timeIt([&] {
+        limitedTable.decode(single.payload.data(), 0, single.payloadBits, &decoded[0], text.size());
+    });
+    report("1 stream", text.size(), seconds, decoded == text);
+    MultiStreamEncoded multi = compressMultiStream(text);
+    seconds = timeIt([&] { decompressMultiStream(multi, decoded); });
+    report("4 streams", text.size(), seconds, decoded == text);
+
+    cout << "Order-1 contexts\n";
+    stringstream order0In(text), order0Out;
+    compressStream(order0In, order0Out);
+    stringstream contextPacked;
+    ContextStats contextStats;
+    seconds = timeIt([&] { contextStats = compressContext(text, contextPacked); });
+    report("encode", text.size(), seconds, true);
+    seconds = timeIt([&] { decompressContext(contextPacked, decoded); });
+    report("decode", text.size(), seconds, decoded == text);
+    cout << "  " << contextStats.contextTables << " tables, ratio " << setprecision(4)
+         << (double)contextPacked.str().size() / text.size() << " vs order-0 "
+         << (double)order0Out.str().size() / text.size() << "\n";
+
+    cout << "Block mode (1 MiB blocks)\n";
+    for (unsigned threads = 1; threads <= defaultThreadCount(); threads *= 2) {
+        BlockEncoded blocks;
+        seconds = timeIt([&] { blocks = compressBlocks(text, threads); });
+        report("encode x" + to_string(threads), text.size(), seconds, true);
+        seconds = timeIt([&] { decompressBlocks(blocks, decoded, threads); });
+        report("decode x" + to_string(threads), text.size(), seconds, decoded == text);
+    }
+}
+
+// Per-message tables against one pretrained dictionary, on 300-byte messages
+void runSmallMessages() {
+    const size_t messageSize = 300;
+    const size_t numMessages = 10000;
+    string training = makeCorpus(kCorpusEnglish, 1 << 20, 1);
+    string traffic = makeCorpus(kCorpusEnglish, messageSize * numMessages, 2);
+
+    cout << "Small messages (" << numMessages << " x " << messageSize << " bytes)\n";
+    size_t tableBytes = 0;
+    double seconds = timeIt([&] {
+        for (size_t m = 0; m < numMessages; m++) {
+            stringstream in(traffic.substr(m * messageSize, messageSize)), out;
+            compressStream(in, out);
+            tableBytes += out.str().size();
+        }
+    });
+    report("tree per message", traffic.size(), seconds, true);
+
+    StaticDictionary dictionary = trainDictionary(1, training);
+    DictionarySet dictionaries;
+    dictionaries.add(dictionary);
+    vector<string> messages(numMessages);
+    seconds = timeIt([&] {
+        for (size_t m = 0; m < numMessages; m++) {
+            messages[m] = encodeMessage(dictionary, traffic.data() + m * messageSize, messageSize);
+        }
+    });
+    report("dictionary encode", traffic.size(), seconds, true);
+
+    bool ok = true;
+    size_t dictionaryBytes = 0;
+    string decoded;
+    seconds = timeIt([&] {
+        for (size_t m = 0; m < numMessages; m++) {
+            ok &= decodeMessage(dictionaries, messages[m], decoded);
+            dictionaryBytes += messages[m].size();
+        }
+    });
+    report("dictionary decode", traffic.size(), seconds, ok);
+    cout << "  ratio: " << setprecision(4) << (double)tableBytes / traffic.size() << " with a table per message, "
+         << (double)dictionaryBytes / traffic.size() << " with the dictionary\n";
+}
+
+// Usage: HuffmanBenchmark [max size, e.g. 16M or 1G] [runs]
+// The largest corpus is the max size itself; 1G needs about 3 GB of memory for the text, its
+// encoding and the decoded text.
+int main(int argc, char* argv[]) {
+    size_t maxSize = argc > 1 ? parseSize(argv[1]) : (size_t)16 << 20;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+    if (runs < 1) runs = 1;
+
+    runSuite(maxSize, runs);
+    cout << "\n";
+    runComparisons(min(maxSize, (size_t)8 << 20));
+    cout << "\n";
+    runSmallMessages();
+
+    return 0;
+}
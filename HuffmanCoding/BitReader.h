@@ -0,0 +1,119 @@
+#ifndef BITREADER_H
+#define BITREADER_H
+
+#include "BitSet.h"
+#include "BitStream.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Reads MSB-first bits from a BitSet or a packed byte span through a 64-bit window.
+//
+// refill() reloads the window from the current position in one shot (a word or byte load and
+// a shift, no per-bit loop), after which up to kMaxPeekBits can be peeked and consumed without
+// touching memory. Window bits past available() are always zero, so the window can go straight
+// to DecodeTable::decode.
+class BitReader {
+public:
+    static const int kMaxPeekBits = 57;
+
+    // Reads a BitSet in place; the BitSet must outlive the reader and not change
+    explicit BitReader(const BitSet& bits)
+        : fromWords(true), words(bits.getWords().data()), numWords(bits.getWords().size()),
+          tail(bits.getTailWord()), bytes(nullptr), numBits((size_t)bits.size()), position(0), window(0),
+          windowBits(0) {}
+
+    // Reads numBits bits of MSB-first packed bytes
+    BitReader(const uint8_t* data, size_t numBits)
+        : fromWords(false), words(nullptr), numWords(0), tail(0), bytes(data), numBits(numBits), position(0),
+          window(0), windowBits(0) {}
+
+    // Reloads the window so it holds min(kMaxPeekBits, remaining()) valid bits, then zeros
+    void refill() {
+        windowBits = (int)std::min<size_t>(kMaxPeekBits, numBits - position);
+        window = (fromWords ? loadFromWords() : loadFromBytes()) & ~(~(uint64_t)0 >> windowBits);
+    }
+
+    // The next n bits (1 <= n <= available()), right-aligned
+    uint64_t peek(int n) const {
+        return window >> (64 - n);
+    }
+
+    // The window itself, next bit in the MSB
+    uint64_t peekWindow() const {
+        return window;
+    }
+
+    // Skips n bits (0 <= n <= available())
+    void consume(int n) {
+        window <<= n;
+        windowBits -= n;
+        position += n;
+    }
+
+    // Reads one bit, refilling when the window runs dry. Returns false past the end.
+    bool readBit() {
+        if (windowBits == 0) refill();
+        bool bit = (window >> 63) != 0;
+        consume(windowBits > 0 ? 1 : 0);
+        return bit;
+    }
+
+    // Valid bits left in the window
+    int available() const {
+        return windowBits;
+    }
+
+    size_t tell() const {
+        return position;
+    }
+
+    size_t remaining() const {
+        return numBits - position;
+    }
+
+    bool atEnd() const {
+        return position >= numBits;
+    }
+
+private:
+    bool fromWords;
+    const uint64_t* words;
+    size_t numWords;
+    uint64_t tail;
+    const uint8_t* bytes;
+    size_t numBits;
+    size_t position;
+    uint64_t window;
+    int windowBits;
+
+    uint64_t wordAt(size_t index) const {
+        if (index < numWords) return words[index];
+        return index == numWords ? tail : 0;
+    }
+
+    uint64_t loadFromWords() const {
+        size_t index = position / 64;
+        int shift = (int)(position % 64);
+        uint64_t high = wordAt(index) << shift;
+        // Shifting by 64 is undefined, so split the second shift in two
+        uint64_t low = (wordAt(index + 1) >> 1) >> (63 - shift);
+        return high | low;
+    }
+
+    uint64_t loadFromBytes() const {
+        size_t numBytes = (numBits + 7) / 8;
+        size_t index = position / 8;
+        if (index + 8 <= numBytes) {
+            return loadWindow(bytes, position);
+        }
+        // Near the end, gather what is left and pad with zeros
+        uint64_t value = 0;
+        for (size_t i = 0; i < 8; i++) {
+            value = (value << 8) | (index + i < numBytes ? bytes[index + i] : 0);
+        }
+        return value << (position % 8);
+    }
+};
+
+#endif //BITREADER_H
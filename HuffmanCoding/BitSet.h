@@ -6,16 +6,24 @@
 #include <cstdint>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
 class BitSet {
 private:
-    std::vector<uint8_t> bytes;
-    int numBits;
+    // Full 64-bit words, first bit in the MSB. Bits that do not yet fill a word wait in the
+    // accumulator (right-aligned, only the low accumulatorBits are set).
+    std::vector<uint64_t> words;
+    uint64_t accumulator;
+    int accumulatorBits;
+    size_t numBits;
+    // Packed form for getBytes(), filled on first request and dropped by every append
+    mutable std::vector<uint8_t> bytes;
+    mutable bool bytesCached;
 
 public:
-    BitSet() : numBits(0) {}
+    BitSet() : accumulator(0), accumulatorBits(0), numBits(0), bytesCached(false) {}
 
-    BitSet(const std::string& bitString) : numBits(0) {
+    BitSet(const std::string& bitString) : BitSet() {
         for (char c : bitString) {
             if (c == '1') {
                 append(true);
@@ -26,79 +34,145 @@ public:
     }
 
     void append(bool bit) {
-        if (numBits % 8 == 0) {
-            bytes.push_back(0);
-        }
+        bytesCached = false;
+        accumulator = (accumulator << 1) | (bit ? 1 : 0);
+        accumulatorBits++;
+        numBits++;
 
-        if (bit) {
-            int byteIndex = numBits / 8;
-            int bitIndex = 7 - (numBits % 8);
-            bytes[byteIndex] |= (1 << bitIndex);
+        if (accumulatorBits == 64) {
+            words.push_back(accumulator);
+            accumulator = 0;
+            accumulatorBits = 0;
         }
+    }
 
-        numBits++;
+    // Appends the low n bits of value (0 <= n <= 64), most significant of them first
+    void appendBits(uint64_t value, int n) {
+        if (n <= 0) return;
+        bytesCached = false;
+        if (n < 64) value &= ((uint64_t)1 << n) - 1;
+
+        int free = 64 - accumulatorBits;
+        if (n < free) {
+            accumulator = (accumulator << n) | value;
+            accumulatorBits += n;
+        } else {
+            int rest = n - free;
+            uint64_t high = free == 64 ? 0 : accumulator << free;
+            words.push_back(high | (value >> rest));
+            accumulator = rest == 0 ? 0 : value & (((uint64_t)1 << rest) - 1);
+            accumulatorBits = rest;
+        }
+        numBits += n;
     }
 
     void append(const BitSet& other) {
-        for (int i = 0; i < other.numBits; i++) {
-            append(other.getBit(i));
+        bytesCached = false;
+        if (accumulatorBits == 0) {
+            words.insert(words.end(), other.words.begin(), other.words.end());
+            numBits += other.words.size() * 64;
+        } else {
+            for (uint64_t word : other.words) {
+                appendBits(word, 64);
+            }
         }
+        appendBits(other.accumulator, other.accumulatorBits);
     }
 
-    bool getBit(int index) const {
+    void reserve(size_t bits) {
+        words.reserve(bits / 64 + 1);
+    }
+
+    bool getBit(size_t index) const {
         if (index >= numBits) return false;
 
-        int byteIndex = index / 8;
-        int bitIndex = 7 - (index % 8);
-        return (bytes[byteIndex] & (1 << bitIndex)) != 0;
+        size_t wordIndex = index / 64;
+        if (wordIndex < words.size()) {
+            return (words[wordIndex] >> (63 - index % 64)) & 1;
+        }
+        int offset = (int)(index - words.size() * 64);
+        return (accumulator >> (accumulatorBits - 1 - offset)) & 1;
     }
 
-    int size() const {
+    size_t size() const {
         return numBits;
     }
 
-    int sizeInBytes() const {
+    size_t sizeInBytes() const {
         return (numBits + 7) / 8;
     }
 
     std::string toBinaryString() const {
         std::string result;
-        for (int i = 0; i < numBits; i++) {
+        for (size_t i = 0; i < numBits; i++) {
             result += getBit(i) ? '1' : '0';
         }
         return result;
     }
 
     std::string toHexString(int numBytes = -1) const {
-        if (numBytes == -1) {
-            numBytes = sizeInBytes();
-        }
-
+        size_t count = numBytes < 0 ? sizeInBytes() : std::min(sizeInBytes(), (size_t)numBytes);
         std::stringstream ss;
-        for (int i = 0; i < numBytes && i < (int)bytes.size(); i++) {
-            ss << std::hex << std::setw(2) << std::setfill('0') << (int)bytes[i];
+        for (size_t i = 0; i < count; i++) {
+            ss << std::hex << std::setw(2) << std::setfill('0') << (int)getByte(i);
         }
         return ss.str();
     }
 
     std::string getFirstNBytesAsBinary(int n) const {
         std::string result;
-        for (int i = 0; i < n * 8 && i < numBits; i++) {
+        for (size_t i = 0; i < (size_t)n * 8 && i < numBits; i++) {
             result += getBit(i) ? '1' : '0';
         }
         return result;
     }
 
+    // Byte index of the packed form (index < sizeInBytes()), without building it
+    uint8_t getByte(size_t index) const {
+        size_t wordIndex = index / 8;
+        uint64_t word = wordIndex < words.size() ? words[wordIndex] : getTailWord();
+        return (uint8_t)(word >> (56 - 8 * (index % 8)));
+    }
+
+    // Packed bytes, first bit in the MSB of the first byte. Built on the first call after a
+    // change and kept until the next one; like any first use of a lazily filled cache, that
+    // call must not race with another.
     const std::vector<uint8_t>& getBytes() const {
+        if (bytesCached) return bytes;
+
+        bytes.resize(sizeInBytes());
+        size_t i = 0;
+        for (uint64_t word : words) {
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                bytes[i++] = (uint8_t)(word >> shift);
+            }
+        }
+        if (accumulatorBits > 0) {
+            uint64_t tail = getTailWord();
+            for (int shift = 56; i < bytes.size(); shift -= 8) {
+                bytes[i++] = (uint8_t)(tail >> shift);
+            }
+        }
+        bytesCached = true;
         return bytes;
     }
 
+    // A copy of getBytes() for callers that need to own or modify the bytes
+    std::vector<uint8_t> copyBytes() const {
+        return getBytes();
+    }
+
+    const std::vector<uint64_t>& getWords() const {
+        return words;
+    }
+
+    // The last, partially filled word, left-aligned like the entries of getWords()
+    uint64_t getTailWord() const {
+        return accumulatorBits == 0 ? 0 : accumulator << (64 - accumulatorBits);
+    }
+
     bool operator==(const BitSet& other) const {
-        if (numBits != other.numBits) return false;
-        for (int i = 0; i < numBits; i++) {
-            if (getBit(i) != other.getBit(i)) return false;
-        }
-        return true;
+        return numBits == other.numBits && accumulator == other.accumulator && words == other.words;
     }
 
     bool operator!=(const BitSet& other) const {
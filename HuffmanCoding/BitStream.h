@@ -0,0 +1,126 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <cstdint>
+
+// Default block size for streaming reads and writes; resident memory stays at a few of these
+const size_t kStreamBlockSize = 1 << 16;
+
+// Bytes of zero padding a buffer needs past its last data byte for loadWindow
+const size_t kWindowPadding = 8;
+
+// Big-endian 64-bit load shifted so bit bitPosition is in the MSB; at least 57 bits are valid.
+// Decoders that reload at most once per few codes keep their dependency chain to a shift and
+// a table lookup per code.
+inline uint64_t loadWindow(const uint8_t* data, uint64_t bitPosition) {
+    const uint8_t* p = data + bitPosition / 8;
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value << (bitPosition % 8);
+}
+
+// Packs bits MSB-first into a fixed-size buffer that is written out each time it fills.
+class BitOutputStream {
+public:
+    explicit BitOutputStream(std::ostream& out, size_t bufferSize = kStreamBlockSize)
+        : out(out), buffer(bufferSize), used(0), accumulator(0), accumulatorBits(0), totalBits(0) {}
+
+    ~BitOutputStream() {
+        flush();
+    }
+
+    // Writes the low n bits of value, most significant first (0 <= n <= 56)
+    void writeBits(uint64_t value, int n) {
+        accumulator = (accumulator << n) | (value & (((uint64_t)1 << n) - 1));
+        accumulatorBits += n;
+        totalBits += n;
+
+        while (accumulatorBits >= 8) {
+            accumulatorBits -= 8;
+            buffer[used++] = (char)(accumulator >> accumulatorBits);
+            if (used == buffer.size()) {
+                out.write(buffer.data(), used);
+                used = 0;
+            }
+        }
+    }
+
+    // Writes out everything buffered, zero-padding the final partial byte
+    void flush() {
+        if (accumulatorBits > 0) {
+            int padding = 8 - accumulatorBits;
+            writeBits(0, padding);
+            totalBits -= padding;
+        }
+        if (used > 0) {
+            out.write(buffer.data(), used);
+            used = 0;
+        }
+        out.flush();
+    }
+
+    uint64_t bitsWritten() const {
+        return totalBits;
+    }
+
+private:
+    std::ostream& out;
+    std::vector<char> buffer;
+    size_t used;
+    uint64_t accumulator;
+    int accumulatorBits;
+    uint64_t totalBits;
+};
+
+// Reads an MSB-first packed stream block by block into a left-aligned 64-bit window.
+// Once the stream runs out the window is padded with zero bits.
+class BitInputStream {
+public:
+    explicit BitInputStream(std::istream& in, size_t bufferSize = kStreamBlockSize)
+        : in(in), buffer(bufferSize), position(0), filled(0), window(0), windowBits(0) {}
+
+    // Tops the window up to at least 57 bits unless the stream is exhausted
+    void refill() {
+        while (windowBits <= 56) {
+            if (position == filled && !fillBuffer()) return;
+            window |= (uint64_t)(uint8_t)buffer[position++] << (56 - windowBits);
+            windowBits += 8;
+        }
+    }
+
+    uint64_t peek() const {
+        return window;
+    }
+
+    // Number of real (non-padding) bits in the window
+    int available() const {
+        return windowBits;
+    }
+
+    void consume(int n) {
+        window <<= n;
+        windowBits -= n;
+    }
+
+private:
+    std::istream& in;
+    std::vector<char> buffer;
+    size_t position;
+    size_t filled;
+    uint64_t window;
+    int windowBits;
+
+    bool fillBuffer() {
+        in.read(buffer.data(), buffer.size());
+        filled = (size_t)in.gcount();
+        position = 0;
+        return filled > 0;
+    }
+};
+
+#endif //BITSTREAM_H
@@ -0,0 +1,292 @@
+#ifndef BLOCKCODEC_H
+#define BLOCKCODEC_H
+
+#include "HuffmanTree.h"
+#include "HuffmanFile.h"
+#include "DecodeTable.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sstream>
+
+// Block-parallel layout (all integers little-endian):
+//
+//   magic           4 bytes   "HUB1"
+//   flags           1 byte    as in HuffmanFile.h
+//   original length 8 bytes
+//   block size      4 bytes   characters per block (the last block may be shorter)
+//   code lengths    as in HuffmanFile.h, one canonical table shared by every block
+//   block index     per block: 8-byte bit offset into the payload, 4-byte CRC-32 of its text
+//   payload bits    8 bytes
+//   payload         each block's codes packed MSB-first, starting on a byte boundary
+//
+// Blocks are encoded independently against the shared table, so both directions run one
+// block per task on the worker threads.
+
+const char kBlockMagic[4] = {'H', 'U', 'B', '1'};
+const size_t kDefaultBlockSize = 1 << 20;
+
+struct BlockEncoded {
+    uint64_t originalLength;
+    uint32_t blockSize;
+    std::array<uint8_t, 256> codeLengths;
+    std::vector<uint64_t> blockOffsets;
+    std::vector<uint32_t> blockChecksums;
+    std::vector<uint8_t> payload;
+    uint64_t payloadBits;
+};
+
+/**
+ * Works out everything about a block encoding except the payload: the shared table, each
+ * block's checksum, and where each block's codes go. Block sizes come from the per-block
+ * histograms, so nothing is encoded yet and the payload can be written straight to its final
+ * place by encodeBlocks.
+ * @param table Receives the encode table for the shared code lengths.
+ * @return The index, with an empty payload.
+ */
+inline BlockEncoded planBlocks(const char* data, size_t size, unsigned threads, uint32_t blockSize,
+                               EncodeTable& table) {
+    BlockEncoded encoded{size, blockSize, {}, {}, {}, {}, 0};
+    size_t numBlocks = (size + blockSize - 1) / blockSize;
+    auto blockLength = [&](size_t b) { return std::min<size_t>(blockSize, size - b * blockSize); };
+
+    // Histogram and checksum each block in parallel, then merge into one table
+    std::vector<Histogram> blockCounts(numBlocks, Histogram{});
+    encoded.blockChecksums.resize(numBlocks);
+    parallelFor(numBlocks, threads, [&](size_t b) {
+        const char* block = data + b * blockSize;
+        size_t length = blockLength(b);
+        addToHistogram(block, length, blockCounts[b]);
+        encoded.blockChecksums[b] = crc32Update(0, block, length);
+    });
+
+    Histogram counts{};
+    for (const Histogram& block : blockCounts) {
+        for (int i = 0; i < 256; i++) counts[i] += block[i];
+    }
+
+    HuffmanTree tree;
+    tree.buildTree(histogramToFrequencies(counts));
+    tree.generateCanonicalCodes(kContainerMaxCodeLength);
+    encoded.codeLengths = tree.getCanonicalCodeLengths();
+    table = tree.getCanonicalEncodeTable();
+
+    // Lay the blocks out back to back on byte boundaries
+    encoded.blockOffsets.resize(numBlocks);
+    uint64_t offset = 0;
+    for (size_t b = 0; b < numBlocks; b++) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 256; i++) bits += blockCounts[b][i] * encoded.codeLengths[i];
+        encoded.blockOffsets[b] = offset;
+        encoded.payloadBits = offset + bits;
+        offset += (bits + 7) / 8 * 8;
+    }
+    return encoded;
+}
+
+// Encodes every block of data into payload, at the offsets planBlocks chose;
+// payload must hold (index.payloadBits + 7) / 8 bytes
+inline void encodeBlocks(const char* data, const BlockEncoded& index, const EncodeTable& table, uint8_t* payload,
+                         unsigned threads) {
+    size_t numBlocks = index.blockOffsets.size();
+    parallelFor(numBlocks, threads, [&](size_t b) {
+        size_t first = b * index.blockSize;
+        size_t length = std::min<size_t>(index.blockSize, index.originalLength - first);
+        table.encode(data + first, length, payload + index.blockOffsets[b] / 8);
+    });
+}
+
+/**
+ * Encodes text in independent blocks on a pool of worker threads.
+ * @param data The input.
+ * @param size Number of characters in data.
+ * @param threads Number of worker threads.
+ * @param blockSize Characters per block.
+ */
+inline BlockEncoded compressBlocks(const char* data, size_t size, unsigned threads = defaultThreadCount(),
+                                   uint32_t blockSize = kDefaultBlockSize) {
+    EncodeTable table;
+    BlockEncoded encoded = planBlocks(data, size, threads, blockSize, table);
+    encoded.payload.resize((encoded.payloadBits + 7) / 8);
+    encodeBlocks(data, encoded, table, encoded.payload.data(), threads);
+    return encoded;
+}
+
+inline BlockEncoded compressBlocks(const std::string& text, unsigned threads = defaultThreadCount(),
+                                   uint32_t blockSize = kDefaultBlockSize) {
+    return compressBlocks(text.data(), text.size(), threads, blockSize);
+}
+
+/**
+ * Decodes every block in parallel into out, checking each block against its checksum. The
+ * payload is passed separately so it can come straight from a mapped file.
+ * @param index Everything but the payload; index.payload is ignored.
+ * @param payload Packed codes, at least (index.payloadBits + 7) / 8 bytes.
+ * @param out Receives index.originalLength characters.
+ * @return false if the index is inconsistent or any block fails to decode or verify.
+ */
+inline bool decompressBlocks(const BlockEncoded& index, const uint8_t* payload, size_t payloadBytes,
+                             char* out, unsigned threads = defaultThreadCount()) {
+    if (index.blockSize == 0) return false;
+    size_t numBlocks = (index.originalLength + index.blockSize - 1) / index.blockSize;
+    if (index.blockOffsets.size() != numBlocks || index.blockChecksums.size() != numBlocks
+        || index.payloadBits > (uint64_t)payloadBytes * 8 || index.originalLength > index.payloadBits) {
+        return false;
+    }
+    for (size_t b = 0; b < numBlocks; b++) {
+        uint64_t end = b + 1 < numBlocks ? index.blockOffsets[b + 1] : index.payloadBits;
+        if (index.blockOffsets[b] > end) return false;
+    }
+
+    DecodeTable table;
+    if (!table.build(index.codeLengths)) return false;
+
+    std::vector<char> ok(numBlocks, 0);
+    parallelFor(numBlocks, threads, [&](size_t b) {
+        uint64_t start = index.blockOffsets[b];
+        uint64_t end = b + 1 < numBlocks ? index.blockOffsets[b + 1] : index.payloadBits;
+        size_t first = b * index.blockSize;
+        size_t length = std::min<size_t>(index.blockSize, index.originalLength - first);
+        ok[b] = table.decode(payload, start, end, out + first, length)
+                && crc32Update(0, out + first, length) == index.blockChecksums[b];
+    });
+
+    for (char blockOk : ok) {
+        if (!blockOk) return false;
+    }
+    return true;
+}
+
+/**
+ * Decodes every block in parallel into out, checking each block against its checksum.
+ * @return false if the index is inconsistent or any block fails to decode or verify.
+ */
+inline bool decompressBlocks(const BlockEncoded& encoded, std::string& out,
+                             unsigned threads = defaultThreadCount()) {
+    // Every character takes at least one bit, so this bounds what a corrupt index can allocate
+    if (encoded.originalLength > encoded.payloadBits) {
+        out.clear();
+        return false;
+    }
+    out.assign(encoded.originalLength, '\0');
+    if (!decompressBlocks(encoded, encoded.payload.data(), encoded.payload.size(), &out[0], threads)) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+// Writes everything up to the payload bytes themselves
+inline void writeBlockIndex(std::ostream& out, const BlockEncoded& encoded) {
+    out.write(kBlockMagic, 4);
+    out.put((char)codeLengthFlags(encoded.codeLengths));
+    writeLittleEndian(out, encoded.originalLength, 8);
+    writeLittleEndian(out, encoded.blockSize, 4);
+    writeCodeLengths(out, encoded.codeLengths);
+    for (size_t b = 0; b < encoded.blockOffsets.size(); b++) {
+        writeLittleEndian(out, encoded.blockOffsets[b], 8);
+        writeLittleEndian(out, encoded.blockChecksums[b], 4);
+    }
+    writeLittleEndian(out, encoded.payloadBits, 8);
+}
+
+// Reads everything up to the payload, leaving the stream positioned at its first byte
+inline bool readBlockIndex(std::istream& in, BlockEncoded& encoded) {
+    char magic[4];
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kBlockMagic)) return false;
+
+    uint64_t blockSize;
+    int flags = in.get();
+    if (flags == EOF || !readLittleEndian(in, encoded.originalLength, 8)
+        || !readLittleEndian(in, blockSize, 4) || blockSize == 0
+        || !readCodeLengths(in, flags, encoded.codeLengths)) {
+        return false;
+    }
+    encoded.blockSize = (uint32_t)blockSize;
+
+    uint64_t numBlocks = (encoded.originalLength + blockSize - 1) / blockSize;
+    encoded.blockOffsets.clear();
+    encoded.blockChecksums.clear();
+    for (uint64_t b = 0; b < numBlocks; b++) {
+        uint64_t offset, checksum;
+        if (!readLittleEndian(in, offset, 8) || !readLittleEndian(in, checksum, 4)) return false;
+        encoded.blockOffsets.push_back(offset);
+        encoded.blockChecksums.push_back((uint32_t)checksum);
+    }
+    return readLittleEndian(in, encoded.payloadBits, 8);
+}
+
+inline void writeBlocks(std::ostream& out, const BlockEncoded& encoded) {
+    writeBlockIndex(out, encoded);
+    out.write((const char*)encoded.payload.data(), (std::streamsize)encoded.payload.size());
+}
+
+inline bool readBlocks(std::istream& in, BlockEncoded& encoded) {
+    if (!readBlockIndex(in, encoded)) return false;
+    encoded.payload.clear();
+    return readBytes(in, encoded.payload, (encoded.payloadBits + 7) / 8);
+}
+
+/**
+ * Compresses a file into the block format through memory maps: the input is read in place, the
+ * output file is sized up front from the block plan, and every block is encoded directly into
+ * its place in the output mapping.
+ * @return false if either file cannot be opened, mapped or written, or if both paths name the
+ * same file. The output is written under a temporary name and renamed into place at the end,
+ * so on failure an existing output file is left as it was.
+ */
+inline bool compressBlockFile(const std::string& inputPath, const std::string& outputPath,
+                              unsigned threads = defaultThreadCount()) {
+    MappedFile in;
+    if (!in.openRead(inputPath) || in.isSameFile(outputPath)) return false;
+    EncodeTable table;
+    BlockEncoded index = planBlocks((const char*)in.data(), in.size(), threads, kDefaultBlockSize, table);
+
+    std::ostringstream header;
+    writeBlockIndex(header, index);
+    std::string headerBytes = header.str();
+    size_t payloadBytes = (size_t)((index.payloadBits + 7) / 8);
+
+    // The blocks encode straight into the output mapping, with no intermediate payload
+    MappedFile out;
+    if (!out.create(outputPath, headerBytes.size() + payloadBytes)) return false;
+    std::memcpy(out.mutableData(), headerBytes.data(), headerBytes.size());
+    encodeBlocks((const char*)in.data(), index, table, out.mutableData() + headerBytes.size(), threads);
+    return out.commit();
+}
+
+/**
+ * Decompresses a block-format file through memory maps. The output file is sized from the
+ * header and the blocks decode straight into its mapping.
+ * @return false on an unreadable or malformed input, a checksum mismatch, a write error or
+ * both paths naming the same file. As with compressBlockFile, an existing output file is only
+ * replaced once the whole output has been written.
+ */
+inline bool decompressBlockFile(const std::string& inputPath, const std::string& outputPath,
+                                unsigned threads = defaultThreadCount()) {
+    MappedFile in;
+    if (!in.openRead(inputPath) || in.isSameFile(outputPath)) return false;
+
+    MemoryStreamBuf buffer(in.data(), in.size());
+    std::istream stream(&buffer);
+    BlockEncoded index;
+    if (!readBlockIndex(stream, index)) return false;
+
+    size_t payloadBytes = in.size() - buffer.position();
+    if (index.payloadBits > (uint64_t)payloadBytes * 8 || index.originalLength > index.payloadBits) return false;
+
+    MappedFile out;
+    if (!out.create(outputPath, (size_t)index.originalLength)) return false;
+    bool ok = decompressBlocks(index, in.data() + buffer.position(), payloadBytes,
+                               (char*)out.mutableData(), threads);
+    if (!ok) {
+        out.discard();
+        return false;
+    }
+    return out.commit();
+}
+
+#endif //BLOCKCODEC_H
@@ -0,0 +1,61 @@
+#ifndef CANONICALCODES_H
+#define CANONICALCODES_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <climits>
+
+// Canonical codes for a set of code lengths, shared by EncodeTable, DecodeTable and HuffmanTree
+// so all three agree on the order: by length, then by character value as a (signed) char.
+struct CanonicalCodes {
+    static const int kMaxCodeLength = 64;   // longest code a uint64_t can hold
+
+    std::array<uint64_t, 256> codes{};                  // right-aligned, indexed by unsigned char
+    std::vector<uint8_t> sortedSymbols;                 // present symbols in canonical order
+    std::array<int, kMaxCodeLength + 1> counts{};       // codes of each length
+    std::array<uint64_t, kMaxCodeLength + 1> firstCode{};
+    std::array<int, kMaxCodeLength + 1> offsets{};      // sortedSymbols index of each length's first code
+    int maxLength = 0;
+};
+
+/**
+ * Assigns canonical codes from code lengths alone.
+ *
+ * @param lengths Code length of each byte value, indexed by unsigned char; 0 means absent.
+ * @param canonical Receives the codes, replacing whatever it held.
+ * @return false if a length exceeds CanonicalCodes::kMaxCodeLength.
+ */
+inline bool assignCanonicalCodes(const std::array<uint8_t, 256>& lengths, CanonicalCodes& canonical) {
+    canonical = CanonicalCodes();
+    for (uint8_t len : lengths) {
+        if (len > CanonicalCodes::kMaxCodeLength) return false;
+        canonical.counts[len]++;
+        if (len > canonical.maxLength) canonical.maxLength = len;
+    }
+    canonical.counts[0] = 0;
+
+    int total = 0;
+    uint64_t code = 0;
+    for (int len = 1; len <= canonical.maxLength; len++) {
+        canonical.offsets[len] = total;
+        total += canonical.counts[len];
+        code = (code + canonical.counts[len - 1]) << 1;
+        canonical.firstCode[len] = code;
+    }
+
+    // Counting sort by (length, character); each symbol's code follows from its sorted position
+    canonical.sortedSymbols.resize(total);
+    std::array<int, CanonicalCodes::kMaxCodeLength + 1> next = canonical.offsets;
+    for (int v = CHAR_MIN; v <= CHAR_MAX; v++) {
+        uint8_t symbol = (uint8_t)(char)v;
+        uint8_t len = lengths[symbol];
+        if (len == 0) continue;
+        int index = next[len]++;
+        canonical.sortedSymbols[index] = symbol;
+        canonical.codes[symbol] = canonical.firstCode[len] + (uint64_t)(index - canonical.offsets[len]);
+    }
+    return true;
+}
+
+#endif //CANONICALCODES_H
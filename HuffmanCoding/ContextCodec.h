@@ -0,0 +1,220 @@
+#ifndef CONTEXTCODEC_H
+#define CONTEXTCODEC_H
+
+#include "HuffmanTree.h"
+#include "HuffmanFile.h"
+#include "AdaptiveCodec.h"
+#include "DecodeTable.h"
+#include "EncodeTable.h"
+#include "Frequency.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Order-1 context layout (all integers little-endian):
+//
+//   magic           4 bytes   "HUC1"
+//   original length 8 bytes
+//   shared table    flags byte + code lengths, as in HuffmanFile.h
+//   table count     1 byte    number of context tables, 0 to 255
+//   context map     256 bytes, only if there are context tables: for each previous byte,
+//                   0 for the shared table or 1 + the index of its context table
+//   context tables  flags byte + code lengths each
+//   payload bits    8 bytes
+//   payload         packed codes; each character is coded with the table its predecessor
+//                   selects (the first character's predecessor is taken to be 0)
+//   checksum        4 bytes   CRC-32 of the original data
+//
+// A previous byte only gets its own table when coding its successors with it saves more than
+// the table costs to store; every other byte shares one order-0 table built from what is left.
+
+const char kContextMagic[4] = {'H', 'U', 'C', '1'};
+const int kMaxContextTables = 255;
+
+struct ContextStats {
+    size_t contextTables;      // previous bytes with a table of their own
+    uint64_t estimatedSavings; // bits saved over coding everything with one order-0 table
+};
+
+// Code lengths for a histogram, limited to the container's maximum length
+inline std::array<uint8_t, 256> contextCodeLengths(const Histogram& counts) {
+    HuffmanTree tree;
+    tree.buildTree(histogramToFrequencies(counts));
+    tree.generateCanonicalCodes(kContainerMaxCodeLength);
+    return tree.getCanonicalCodeLengths();
+}
+
+/**
+ * Compresses text with up to kMaxContextTables order-1 context tables.
+ * @return How many context tables were worth storing, and the estimated gain.
+ */
+inline ContextStats compressContext(const std::string& text, std::ostream& out) {
+    std::vector<Histogram> contextCounts(256, Histogram{});
+    Histogram total{};
+    uint8_t previous = 0;
+    for (char c : text) {
+        contextCounts[previous][(uint8_t)c]++;
+        previous = (uint8_t)c;
+    }
+    for (const Histogram& counts : contextCounts) {
+        for (int i = 0; i < 256; i++) total[i] += counts[i];
+    }
+
+    // Price each context against the order-0 table; only build a table where the entropy
+    // estimate says it could pay for itself, and keep it only if the real table does
+    std::array<uint8_t, 256> order0 = text.empty() ? std::array<uint8_t, 256>{} : contextCodeLengths(total);
+    const uint64_t tableBits = 8 + 128 * 8;
+    struct Candidate {
+        int context;
+        uint64_t savings;
+        std::array<uint8_t, 256> lengths;
+    };
+    std::vector<Candidate> candidates;
+    for (int c = 0; c < 256; c++) {
+        uint64_t count = 0;
+        for (uint64_t n : contextCounts[c]) count += n;
+        if (count == 0) continue;
+
+        uint64_t sharedBits = codedSizeBits(contextCounts[c], order0);
+        uint64_t entropy = entropyBits(contextCounts[c], count);
+        if (entropy + entropy / 64 + tableBits >= sharedBits) continue;
+
+        std::array<uint8_t, 256> lengths = contextCodeLengths(contextCounts[c]);
+        uint64_t ownBits = codedSizeBits(contextCounts[c], lengths) + tableBits;
+        if (ownBits < sharedBits) {
+            candidates.push_back({c, sharedBits - ownBits, lengths});
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.savings > b.savings;
+    });
+    if (candidates.size() > kMaxContextTables) candidates.resize(kMaxContextTables);
+
+    // The shared table only has to cover the contexts left without a table
+    std::array<uint8_t, 256> contextMap{};
+    ContextStats stats{candidates.size(), 0};
+    for (size_t t = 0; t < candidates.size(); t++) {
+        contextMap[candidates[t].context] = (uint8_t)(t + 1);
+        stats.estimatedSavings += candidates[t].savings;
+    }
+    Histogram residual{};
+    for (int c = 0; c < 256; c++) {
+        if (contextMap[c] != 0) continue;
+        for (int i = 0; i < 256; i++) residual[i] += contextCounts[c][i];
+    }
+    std::array<uint8_t, 256> shared = order0;
+    if (!candidates.empty()) {
+        bool anyResidual = std::any_of(residual.begin(), residual.end(), [](uint64_t n) { return n > 0; });
+        shared = anyResidual ? contextCodeLengths(residual) : std::array<uint8_t, 256>{};
+    }
+
+    std::vector<EncodeTable> tables(candidates.size() + 1);
+    tables[0].build(shared);
+    for (size_t t = 0; t < candidates.size(); t++) tables[t + 1].build(candidates[t].lengths);
+
+    out.write(kContextMagic, 4);
+    writeLittleEndian(out, text.size(), 8);
+    out.put((char)codeLengthFlags(shared));
+    writeCodeLengths(out, shared);
+    out.put((char)candidates.size());
+    if (!candidates.empty()) {
+        out.write((const char*)contextMap.data(), 256);
+        for (const Candidate& candidate : candidates) {
+            out.put((char)codeLengthFlags(candidate.lengths));
+            writeCodeLengths(out, candidate.lengths);
+        }
+    }
+
+    // The same emitter as EncodeTable::encode, switching tables per character
+    BitSet bits;
+    previous = 0;
+    uint64_t tail;
+    int tailBits = emitCodes(text.size(), [&](size_t i, uint64_t& code, int& len) {
+        const EncodeTable& table = tables[contextMap[previous]];
+        uint8_t symbol = (uint8_t)text[i];
+        code = table.getBits(symbol);
+        len = table.getLength(symbol);
+        previous = symbol;
+    }, [&bits](uint64_t word) { bits.appendBits(word, 64); }, tail);
+    bits.appendBits(tail, tailBits);
+
+    const std::vector<uint8_t>& bytes = bits.getBytes();
+    writeLittleEndian(out, (uint64_t)bits.size(), 8);
+    out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+    writeLittleEndian(out, crc32Update(0, text.data(), text.size()), 4);
+    return stats;
+}
+
+/**
+ * Decompresses a stream written by compressContext.
+ * @return false on a malformed stream or a checksum mismatch.
+ */
+inline bool decompressContext(std::istream& in, std::string& out) {
+    out.clear();
+    char magic[4];
+    uint64_t length;
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kContextMagic) || !readLittleEndian(in, length, 8)) {
+        return false;
+    }
+
+    std::array<uint8_t, 256> lengths;
+    int flags = in.get();
+    if (flags == EOF || !readCodeLengths(in, flags, lengths)) return false;
+    int numTables = in.get();
+    if (numTables == EOF) return false;
+
+    std::vector<DecodeTable> tables(numTables + 1);
+    if (!tables[0].build(lengths)) return false;
+    std::array<uint8_t, 256> contextMap{};
+    if (numTables > 0 && !in.read((char*)contextMap.data(), 256)) return false;
+    for (int t = 1; t <= numTables; t++) {
+        flags = in.get();
+        if (flags == EOF || !readCodeLengths(in, flags, lengths) || !tables[t].build(lengths)) return false;
+    }
+
+    // One table pointer per previous byte, so the loop does a single lookup to switch tables
+    std::array<const DecodeTable*, 256> tableFor;
+    int maxLength = 1;
+    for (int c = 0; c < 256; c++) {
+        if (contextMap[c] > numTables) return false;
+        tableFor[c] = &tables[contextMap[c]];
+        maxLength = std::max(maxLength, tableFor[c]->getMaxLength());
+    }
+
+    uint64_t numBits;
+    std::vector<uint8_t> payload;
+    if (!readLittleEndian(in, numBits, 8) || length > numBits || !readBytes(in, payload, (numBits + 7) / 8)) {
+        return false;
+    }
+    payload.resize(payload.size() + kWindowPadding, 0);
+
+    std::string text(length, '\0');
+    size_t perReload = 57 / maxLength;
+    uint64_t position = 0;
+    uint8_t previous = 0;
+    size_t i = 0;
+    while (i < length) {
+        size_t count = std::min<size_t>(perReload, length - i);
+        uint64_t window = loadWindow(payload.data(), position);
+        for (size_t k = 0; k < count; k++, i++) {
+            uint8_t symbol;
+            int len = tableFor[previous]->decode(window, symbol);
+            if (len == 0) return false;
+            text[i] = (char)symbol;
+            previous = symbol;
+            window <<= len;
+            position += len;
+        }
+        if (position > numBits) return false;
+    }
+
+    uint64_t expected;
+    if (!readLittleEndian(in, expected, 4) || expected != crc32Update(0, text.data(), text.size())) {
+        return false;
+    }
+    out.swap(text);
+    return true;
+}
+
+#endif //CONTEXTCODEC_H
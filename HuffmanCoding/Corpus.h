@@ -0,0 +1,91 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Synthetic inputs for benchmarking and fuzzing the codec. Every generator is seeded, so a
+// given (kind, size) always produces the same bytes.
+enum CorpusKind { kCorpusUniform, kCorpusZipf, kCorpusEnglish, kCorpusAllBytes, kCorpusSingle };
+
+const CorpusKind kAllCorpora[] = {
+    kCorpusUniform, kCorpusZipf, kCorpusEnglish, kCorpusAllBytes, kCorpusSingle
+};
+
+inline const char* corpusName(CorpusKind kind) {
+    switch (kind) {
+        case kCorpusUniform: return "uniform";
+        case kCorpusZipf: return "zipf";
+        case kCorpusEnglish: return "english";
+        case kCorpusAllBytes: return "all-256";
+        case kCorpusSingle: return "single";
+    }
+    return "?";
+}
+
+// English-like text: random words drawn from a small vocabulary
+inline std::string makeEnglishCorpus(size_t size, std::mt19937& rng) {
+    const std::vector<std::string> words = {
+        "the", "of", "and", "a", "to", "in", "is", "you", "that", "it", "he", "was", "for",
+        "on", "are", "as", "with", "his", "they", "brook", "trout", "streams", "mountains",
+        "amber", "current", "white", "edges", "fins", "softly", "flow", "moss", "maps",
+        "world", "becoming", "mazes", "thing", "deep", "glens", "older", "mystery."
+    };
+    std::string text;
+    text.reserve(size + 16);
+    while (text.size() < size) {
+        text += words[rng() % words.size()];
+        text += (rng() % 12 == 0) ? '\n' : ' ';
+    }
+    text.resize(size);
+    return text;
+}
+
+// Byte values drawn with probability proportional to 1 / rank (Zipf, s = 1)
+inline std::string makeZipfCorpus(size_t size, std::mt19937& rng) {
+    std::vector<double> cumulative(256);
+    double total = 0;
+    for (int rank = 0; rank < 256; rank++) {
+        total += 1.0 / (rank + 1);
+        cumulative[rank] = total;
+    }
+    std::uniform_real_distribution<double> pick(0, total);
+
+    std::string text(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        auto it = std::lower_bound(cumulative.begin(), cumulative.end(), pick(rng));
+        text[i] = (char)std::min<ptrdiff_t>(it - cumulative.begin(), 255);
+    }
+    return text;
+}
+
+inline std::string makeCorpus(CorpusKind kind, size_t size, uint32_t seed = 343) {
+    std::mt19937 rng(seed);
+    std::string text;
+    switch (kind) {
+        case kCorpusUniform:
+            text.resize(size);
+            for (size_t i = 0; i < size; i++) text[i] = (char)(rng() >> 24);
+            break;
+        case kCorpusZipf:
+            text = makeZipfCorpus(size, rng);
+            break;
+        case kCorpusEnglish:
+            text = makeEnglishCorpus(size, rng);
+            break;
+        case kCorpusAllBytes:
+            text.resize(size);
+            for (size_t i = 0; i < size; i++) text[i] = (char)(i % 256);
+            break;
+        case kCorpusSingle:
+            text.assign(size, 'A');
+            break;
+    }
+    return text;
+}
+
+#endif //CORPUS_H
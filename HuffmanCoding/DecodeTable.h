@@ -0,0 +1,267 @@
+#ifndef DECODETABLE_H
+#define DECODETABLE_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "BitStream.h"
+#include "CanonicalCodes.h"
+
+// Lookup-table decoder for canonical Huffman codes.
+//
+// The table is rebuilt from the 256 code lengths alone (indexed by unsigned char, 0 = symbol
+// not present), with codes assigned by assignCanonicalCodes like the encoder's. Decoding peeks
+// kPrimaryBits at a time; codes longer than that go through a small secondary table, and codes
+// that do not fit the secondary table fall back to a canonical first-code walk.
+class DecodeTable {
+public:
+    static const int kPrimaryBits = 11;
+    static const int kSecondaryBits = 8;
+    static const int kMaxCodeLength = 56;   // longest code a 64-bit window can always hold
+
+    // An unbuilt table has no codes: every window decodes as invalid
+    DecodeTable() : valid(false) {
+        primary.fill(Entry{0, 0, kInvalid});
+    }
+
+    explicit DecodeTable(const std::array<uint8_t, 256>& lengths) : DecodeTable() {
+        build(lengths);
+    }
+
+    // Rebuilds the table. Returns false (and leaves the table unusable) if the lengths do not
+    // describe a prefix code or exceed kMaxCodeLength.
+    bool build(const std::array<uint8_t, 256>& lengths) {
+        valid = false;
+        primary.fill(Entry{0, 0, kInvalid});
+        secondary.clear();
+        canonical = CanonicalCodes();
+
+        for (int i = 0; i < 256; i++) {
+            if (lengths[i] > kMaxCodeLength) return false;
+        }
+        assignCanonicalCodes(lengths, canonical);
+        const int maxLength = canonical.maxLength;
+        const auto& counts = canonical.counts;
+        const auto& firstCode = canonical.firstCode;
+        const auto& offsets = canonical.offsets;
+        const auto& sortedSymbols = canonical.sortedSymbols;
+
+        // Kraft inequality: an over-subscribed set of lengths cannot be a prefix code
+        uint64_t kraft = 0;
+        for (int len = 1; len <= maxLength; len++) {
+            kraft += (uint64_t)counts[len] << (kMaxCodeLength - len);
+        }
+        if (kraft > ((uint64_t)1 << kMaxCodeLength)) return false;
+
+        // Short codes fill every primary slot that starts with them
+        for (int len = 1; len <= maxLength && len <= kPrimaryBits; len++) {
+            for (int i = 0; i < counts[len]; i++) {
+                uint64_t c = firstCode[len] + i;
+                uint32_t start = (uint32_t)(c << (kPrimaryBits - len));
+                uint32_t end = (uint32_t)((c + 1) << (kPrimaryBits - len));
+                for (uint32_t slot = start; slot < end; slot++) {
+                    primary[slot] = Entry{sortedSymbols[offsets[len] + i], (uint8_t)len, kLiteral};
+                }
+            }
+        }
+
+        // Long codes share a primary prefix; size each secondary table by the longest code under it
+        std::array<int, 1 << kPrimaryBits> prefixMax{};
+        for (int len = kPrimaryBits + 1; len <= maxLength; len++) {
+            for (int i = 0; i < counts[len]; i++) {
+                uint64_t prefix = (firstCode[len] + i) >> (len - kPrimaryBits);
+                prefixMax[prefix] = len;
+            }
+        }
+        for (int prefix = 0; prefix < (1 << kPrimaryBits); prefix++) {
+            if (prefixMax[prefix] == 0) continue;
+            int bits = prefixMax[prefix] - kPrimaryBits;
+            if (bits > kSecondaryBits) bits = kSecondaryBits;
+            primary[prefix] = Entry{(uint32_t)secondary.size(), (uint8_t)bits, kSubtable};
+            secondary.resize(secondary.size() + ((size_t)1 << bits), Entry{0, 0, kInvalid});
+        }
+        for (int len = kPrimaryBits + 1; len <= maxLength; len++) {
+            for (int i = 0; i < counts[len]; i++) {
+                uint64_t c = firstCode[len] + i;
+                const Entry& link = primary[c >> (len - kPrimaryBits)];
+                int rest = len - kPrimaryBits;
+                uint64_t suffix = c & (((uint64_t)1 << rest) - 1);
+                if (rest <= link.length) {
+                    uint32_t start = (uint32_t)(suffix << (link.length - rest));
+                    uint32_t end = (uint32_t)((suffix + 1) << (link.length - rest));
+                    for (uint32_t slot = start; slot < end; slot++) {
+                        secondary[link.value + slot] = Entry{sortedSymbols[offsets[len] + i], (uint8_t)len, kLiteral};
+                    }
+                } else {
+                    secondary[link.value + (uint32_t)(suffix >> (rest - link.length))] = Entry{0, 0, kSlow};
+                }
+            }
+        }
+
+        valid = true;
+        return true;
+    }
+
+    bool isValid() const {
+        return valid;
+    }
+
+    int getMaxLength() const {
+        return canonical.maxLength;
+    }
+
+    // Decodes one symbol from a left-aligned window (next bit in the MSB). Bits past the end of
+    // the input must be zero. Returns the code length, or 0 (with symbol set to 0) if the window
+    // does not start with a code.
+    int decode(uint64_t window, uint8_t& symbol) const {
+        Entry entry = primary[window >> (64 - kPrimaryBits)];
+        if (entry.kind == kLiteral) {
+            symbol = (uint8_t)entry.value;
+            return entry.length;
+        }
+        return decodeLong(window, entry, symbol);
+    }
+
+    // Decodes numBits bits of MSB-first packed data, appending symbols to out.
+    // Stops early (returning false) on an invalid or truncated code.
+    bool decode(const uint8_t* data, size_t numBits, std::string& out) const {
+        if (!valid) return numBits == 0;
+
+        size_t numBytes = (numBits + 7) / 8;
+        size_t nextByte = 0;
+        size_t position = 0;
+        uint64_t window = 0;
+        int windowBits = 0;
+
+        while (position < numBits) {
+            while (windowBits <= 56 && nextByte < numBytes) {
+                window |= (uint64_t)data[nextByte++] << (56 - windowBits);
+                windowBits += 8;
+            }
+            uint8_t symbol;
+            int len = decode(window, symbol);
+            if (len == 0 || position + len > numBits) return false;
+            out += (char)symbol;
+            window <<= len;
+            windowBits -= len;
+            position += len;
+        }
+        return true;
+    }
+
+    // Decodes exactly numSymbols symbols into out, starting at bit startBit of MSB-first packed
+    // data that is endBit bits long. Independent ranges can be decoded concurrently.
+    // Returns false on an invalid code or if the range runs out first (out is then unspecified).
+    bool decode(const uint8_t* data, size_t startBit, size_t endBit, char* out, size_t numSymbols) const {
+        if (numSymbols == 0) return true;
+        if (!valid || startBit > endBit) return false;
+
+        size_t numBytes = (endBit + 7) / 8;
+        size_t nextByte = startBit / 8;
+        uint64_t window = 0;
+        int windowBits = 0;
+        while (windowBits <= 56 && nextByte < numBytes) {
+            window |= (uint64_t)data[nextByte++] << (56 - windowBits);
+            windowBits += 8;
+        }
+        int skip = (int)(startBit % 8);
+        window <<= skip;
+        windowBits -= skip;
+
+        // Checked once at the end rather than per code. An invalid code decodes as length 0 and
+        // leaves the window where it is; the bits that made it invalid were already loaded, so
+        // every later code is invalid too and the last length tells. Past the end of the data
+        // the window reads zeros, so neither case can run off the buffer.
+        int len = 0;
+        for (size_t i = 0; i < numSymbols; i++) {
+            while (windowBits <= 56 && nextByte < numBytes) {
+                window |= (uint64_t)data[nextByte++] << (56 - windowBits);
+                windowBits += 8;
+            }
+            uint8_t symbol;
+            len = decode(window, symbol);
+            out[i] = (char)symbol;
+            window <<= len;
+            windowBits -= len;
+        }
+        // Bits consumed are the bits loaded less those still in the window (negative if the
+        // last codes ran past the data)
+        size_t position = nextByte * 8 - windowBits;
+        return len != 0 && position <= endBit;
+    }
+
+    // Decodes numSymbols symbols from a packed stream, writing them out in fixed-size blocks.
+    // Returns false on an invalid or truncated code.
+    bool decode(std::istream& in, std::ostream& out, uint64_t numSymbols) const {
+        if (numSymbols > 0 && !valid) return false;
+
+        BitInputStream bits(in);
+        std::vector<char> buffer(kStreamBlockSize);
+        size_t used = 0;
+        bool ok = true;
+
+        for (uint64_t i = 0; i < numSymbols; i++) {
+            bits.refill();
+            uint8_t symbol;
+            int len = decode(bits.peek(), symbol);
+            if (len == 0 || len > bits.available()) {
+                ok = false;
+                break;
+            }
+            bits.consume(len);
+            buffer[used++] = (char)symbol;
+            if (used == buffer.size()) {
+                out.write(buffer.data(), used);
+                used = 0;
+            }
+        }
+        out.write(buffer.data(), used);
+        return ok;
+    }
+
+private:
+    enum Kind : uint8_t { kInvalid, kLiteral, kSubtable, kSlow };
+
+    struct Entry {
+        uint32_t value;   // symbol for literals, secondary offset for subtables
+        uint8_t length;   // code length for literals, index bits for subtables
+        Kind kind;
+    };
+
+    bool valid;
+    std::array<Entry, 1 << kPrimaryBits> primary;
+    std::vector<Entry> secondary;
+    CanonicalCodes canonical;
+
+    // Codes longer than kPrimaryBits, kept out of line so decode() stays small enough to inline
+    int decodeLong(uint64_t window, Entry entry, uint8_t& symbol) const {
+        if (entry.kind == kSubtable) {
+            entry = secondary[entry.value + ((window << kPrimaryBits) >> (64 - entry.length))];
+        }
+        if (entry.kind == kLiteral) {
+            symbol = (uint8_t)entry.value;
+            return entry.length;
+        }
+        if (entry.kind == kSlow) {
+            return decodeSlow(window, symbol);
+        }
+        symbol = 0;
+        return 0;
+    }
+
+    // Canonical codes of one length are consecutive, so a code is found by checking each length
+    int decodeSlow(uint64_t window, uint8_t& symbol) const {
+        for (int len = kPrimaryBits + 1; len <= canonical.maxLength; len++) {
+            uint64_t index = (window >> (64 - len)) - canonical.firstCode[len];
+            if (index < (uint64_t)canonical.counts[len]) {
+                symbol = canonical.sortedSymbols[canonical.offsets[len] + index];
+                return len;
+            }
+        }
+        symbol = 0;
+        return 0;
+    }
+};
+
+#endif //DECODETABLE_H
@@ -0,0 +1,157 @@
+#ifndef ENCODETABLE_H
+#define ENCODETABLE_H
+
+#include "BitSet.h"
+#include "CanonicalCodes.h"
+#include <array>
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * Packs count codes MSB-first into whole 64-bit words. The accumulator stays in locals, so the
+ * loop keeps it in registers whatever the callbacks write to.
+ *
+ * @param codeAt Called once per index, in order, as codeAt(i, code, len); sets a right-aligned
+ *        code of up to 56 bits and its length.
+ * @param wordSink Called with each full 64-bit word.
+ * @param tail Receives the bits that did not fill a word, right-aligned.
+ * @return The number of bits in tail (0 to 63).
+ */
+template <typename CodeAt, typename WordSink>
+inline int emitCodes(size_t count, CodeAt codeAt, WordSink wordSink, uint64_t& tail) {
+    uint64_t accumulator = 0;
+    int accumulatorBits = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t code;
+        int len;
+        codeAt(i, code, len);
+        if (accumulatorBits + len < 64) {
+            accumulator = (accumulator << len) | code;
+            accumulatorBits += len;
+        } else {
+            // accumulatorBits >= 8 here, since len <= 56, so neither shift reaches 64
+            int rest = accumulatorBits + len - 64;
+            wordSink((accumulator << (64 - accumulatorBits)) | (code >> rest));
+            accumulator = code;
+            accumulatorBits = rest;
+        }
+    }
+    tail = accumulator;
+    return accumulatorBits;
+}
+
+// Per-byte {code bits, length} table for the encoder hot loop. Codes are right-aligned in a
+// 64-bit integer, so one lookup replaces a std::map search and a BitSet copy per character.
+class EncodeTable {
+public:
+    static const int kMaxCodeLength = 56;
+
+    EncodeTable() : valid(false) {
+        bits.fill(0);
+        lengths.fill(0);
+    }
+
+    // Returns false (leaving the table unusable) if a code is longer than kMaxCodeLength
+    bool build(const std::map<char, BitSet>& codes) {
+        valid = false;
+        bits.fill(0);
+        lengths.fill(0);
+        for (const auto& pair : codes) {
+            if (pair.second.size() > kMaxCodeLength) return false;
+            uint8_t symbol = (uint8_t)pair.first;
+            for (size_t i = 0; i < pair.second.size(); i++) {
+                bits[symbol] = (bits[symbol] << 1) | (pair.second.getBit(i) ? 1 : 0);
+            }
+            lengths[symbol] = (uint8_t)pair.second.size();
+        }
+        valid = true;
+        return true;
+    }
+
+    // Assigns canonical codes from code lengths alone (indexed by unsigned char, 0 = absent)
+    // with assignCanonicalCodes. Returns false if a length exceeds kMaxCodeLength.
+    bool build(const std::array<uint8_t, 256>& codeLengths) {
+        valid = false;
+        bits.fill(0);
+        lengths.fill(0);
+
+        if (*std::max_element(codeLengths.begin(), codeLengths.end()) > kMaxCodeLength) return false;
+        CanonicalCodes canonical;
+        assignCanonicalCodes(codeLengths, canonical);
+        bits = canonical.codes;
+        lengths = codeLengths;
+        valid = true;
+        return true;
+    }
+
+    bool isValid() const {
+        return valid;
+    }
+
+    uint64_t getBits(uint8_t symbol) const {
+        return bits[symbol];
+    }
+
+    int getLength(uint8_t symbol) const {
+        return lengths[symbol];
+    }
+
+    // Appends the codes for data to out, assembling whole 64-bit words in a local accumulator.
+    // Throws std::out_of_range if a character has no code.
+    void encode(const char* data, size_t size, BitSet& out) const {
+        uint8_t missing = 0;
+        uint64_t tail;
+        int tailBits = emitCodes(size, [&](size_t i, uint64_t& code, int& len) {
+            uint8_t symbol = (uint8_t)data[i];
+            code = bits[symbol];
+            len = lengths[symbol];
+            missing |= (len == 0);
+        }, [&out](uint64_t word) { out.appendBits(word, 64); }, tail);
+        out.appendBits(tail, tailBits);
+
+        if (missing) {
+            throw std::out_of_range("EncodeTable::encode: character has no code");
+        }
+    }
+
+    // Packs the codes for data MSB-first into out, which must have room for the whole result,
+    // zero-padding the last byte. Returns the number of bits written.
+    // Throws std::out_of_range if a character has no code.
+    uint64_t encode(const char* data, size_t size, uint8_t* out) const {
+        uint8_t missing = 0;
+        uint64_t words = 0;
+        uint64_t tail;
+        int tailBits = emitCodes(size, [&](size_t i, uint64_t& code, int& len) {
+            uint8_t symbol = (uint8_t)data[i];
+            code = bits[symbol];
+            len = lengths[symbol];
+            missing |= (len == 0);
+        }, [out, &words](uint64_t word) { storeBigEndian(word, out + 8 * words++, 8); }, tail);
+        uint64_t total = words * 64 + tailBits;
+        if (tailBits > 0) {
+            storeBigEndian(tail << (64 - tailBits), out + 8 * words, (tailBits + 7) / 8);
+        }
+
+        if (missing) {
+            throw std::out_of_range("EncodeTable::encode: character has no code");
+        }
+        return total;
+    }
+
+private:
+    bool valid;
+    std::array<uint64_t, 256> bits;
+    std::array<uint8_t, 256> lengths;
+
+    // Stores the top numBytes bytes of word, most significant first
+    static void storeBigEndian(uint64_t word, uint8_t* out, int numBytes) {
+        for (int i = 0; i < numBytes; i++) {
+            out[i] = (uint8_t)(word >> (56 - 8 * i));
+        }
+    }
+};
+
+#endif //ENCODETABLE_H
@@ -3,18 +3,145 @@
 
 #include <map>
 #include <string>
+#include <array>
+#include <vector>
+#include <istream>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include "ThreadPool.h"
+
+// Byte counts indexed by unsigned char
+typedef std::array<uint64_t, 256> Histogram;
+
+/**
+ * Adds the bytes of data to a histogram. Four interleaved 32-bit count tables are used so that
+ * runs of the same byte update different memory in consecutive iterations instead of stalling
+ * on the previous store; the tables are folded into counts every 1 GiB so they cannot overflow.
+ * @param data The bytes to count.
+ * @param size Number of bytes.
+ * @param counts The histogram to add to.
+ */
+inline void addToHistogram(const char* data, size_t size, Histogram& counts) {
+    const size_t chunkSize = (size_t)1 << 30;
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    while (size > 0) {
+        size_t chunk = std::min(size, chunkSize);
+        uint32_t tables[4][256] = {};
+
+        size_t i = 0;
+        for (; i + 4 <= chunk; i += 4) {
+            tables[0][bytes[i]]++;
+            tables[1][bytes[i + 1]]++;
+            tables[2][bytes[i + 2]]++;
+            tables[3][bytes[i + 3]]++;
+        }
+        for (; i < chunk; i++) {
+            tables[0][bytes[i]]++;
+        }
+
+        for (int b = 0; b < 256; b++) {
+            counts[b] += (uint64_t)tables[0][b] + tables[1][b] + tables[2][b] + tables[3][b];
+        }
+        bytes += chunk;
+        size -= chunk;
+    }
+}
+
+/**
+ * Builds a histogram of data, splitting large inputs into chunks counted on worker threads.
+ * @param threads Number of worker threads; 1 counts on the calling thread only.
+ */
+inline Histogram countHistogram(const char* data, size_t size, unsigned threads = 1) {
+    const size_t minChunk = (size_t)1 << 20;
+    size_t numChunks = std::min<size_t>(threads, (size + minChunk - 1) / minChunk);
+
+    Histogram counts{};
+    if (numChunks <= 1) {
+        addToHistogram(data, size, counts);
+        return counts;
+    }
+
+    size_t chunkSize = (size + numChunks - 1) / numChunks;
+    std::vector<Histogram> partial(numChunks, Histogram{});
+    parallelFor(numChunks, threads, [&](size_t c) {
+        size_t start = c * chunkSize;
+        addToHistogram(data + start, std::min(chunkSize, size - start), partial[c]);
+    });
+    for (const Histogram& p : partial) {
+        for (int b = 0; b < 256; b++) counts[b] += p[b];
+    }
+    return counts;
+}
+
+/**
+ * Converts a histogram to the frequency map HuffmanTree takes. If a count is too large for an
+ * int, every count is divided by the same factor so their ratios hold; a nonzero count never
+ * drops below 1, so every byte that occurs keeps a code.
+ */
+inline std::map<char, int> histogramToFrequencies(const Histogram& counts) {
+    uint64_t largest = *std::max_element(counts.begin(), counts.end());
+    uint64_t divisor = largest > INT_MAX ? largest / INT_MAX + 1 : 1;
+
+    std::map<char, int> frequencies;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) {
+            frequencies[(char)i] = (int)std::max<uint64_t>(counts[i] / divisor, 1);
+        }
+    }
+    return frequencies;
+}
 
 /**
  * Counts the frequencies of each character in a given text.
  * @param text The input passage to analyze.
+ * @param threads Number of worker threads used to count large passages.
  * @return A map of characters and their corresponding frequencies.
  */
-inline std::map<char, int> countFrequencies(const std::string& text) {
-    std::map<char, int> frequencies;
-    for (char c : text) {
-        frequencies[c]++;
+inline std::map<char, int> countFrequencies(const std::string& text, unsigned threads = 1) {
+    return histogramToFrequencies(countHistogram(text.data(), text.size(), threads));
+}
+
+/**
+ * Counts character frequencies by reading a stream in fixed-size blocks.
+ * The read position is restored afterwards, so a seekable stream can be encoded in a second pass.
+ * @param in The stream to analyze.
+ * @param limit Maximum number of bytes to read; pass a small value to sample a prefix.
+ * @param blockSize Size of the read buffer.
+ * @return A map of characters and their corresponding frequencies.
+ */
+inline std::map<char, int> countFrequencies(std::istream& in, uint64_t limit = UINT64_MAX,
+                                            size_t blockSize = 1 << 16) {
+    Histogram counts{};
+    std::vector<char> buffer(blockSize);
+    std::istream::pos_type start = in.tellg();
+
+    while (limit > 0 && in) {
+        in.read(buffer.data(), (std::streamsize)std::min<uint64_t>(buffer.size(), limit));
+        size_t got = (size_t)in.gcount();
+        addToHistogram(buffer.data(), got, counts);
+        limit -= got;
+        if (got == 0) break;
+    }
+
+    in.clear();
+    if (start != std::istream::pos_type(-1)) {
+        in.seekg(start);
+    }
+
+    return histogramToFrequencies(counts);
+}
+
+/**
+ * Gives every byte value missing from a frequency table a count of 1, so that a tree built
+ * from a sampled or provided table can still encode any input.
+ * @param frequencies The table to extend.
+ */
+inline void includeAllBytes(std::map<char, int>& frequencies) {
+    for (int i = 0; i < 256; i++) {
+        frequencies.emplace((char)i, 1);
     }
-    return frequencies;
 }
 
 #endif // FREQUENCY_H
@@ -0,0 +1,205 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <iterator>
+#include "BitSet.h"
+#include "HuffmanTree.h"
+#include "HuffmanFile.h"
+#include "BlockCodec.h"
+#include "AdaptiveCodec.h"
+#include "MultiStream.h"
+#include "ContextCodec.h"
+#include "StaticDictionary.h"
+#include "Corpus.h"
+
+using namespace std;
+
+// Decoder fuzz target. The first input byte picks a decoder and the rest is handed to it as
+// an encoded stream; every decoder must reject bad input by returning false, never by
+// crashing, hanging or allocating more than the input can back.
+//
+// Built with -DHUFFMAN_LIBFUZZER=ON (Clang) this is a libFuzzer target. Otherwise main() below
+// drives it by mutating valid encodings of random corpora.
+
+enum FuzzTarget { kFuzzFile, kFuzzBlocks, kFuzzAdaptive, kFuzzMultiStream, kFuzzContext, kFuzzMessage,
+                  kFuzzTreeWalk, kFuzzCanonical, kFuzzSingleSymbol, kNumFuzzTargets };
+
+const string kFuzzPassage = "Once there were brook trouts in the streams in the mountains. "
+                            "You could see them standing in the amber current.";
+
+struct FuzzTrees {
+    HuffmanTree passage;
+    HuffmanTree single;
+    StaticDictionary dictionary;
+    DictionarySet dictionaries;
+
+    FuzzTrees() {
+        passage.buildTree(passage.countFrequencies(kFuzzPassage));
+        passage.generateCodes();
+        passage.generateCanonicalCodes();
+        single.buildTree(single.countFrequencies("aaaa"));
+        single.generateCodes();
+        single.generateCanonicalCodes();
+        dictionary = trainDictionary(1, kFuzzPassage);
+        dictionaries.add(dictionary);
+    }
+};
+
+const FuzzTrees& fuzzTrees() {
+    static const FuzzTrees trees;
+    return trees;
+}
+
+BitSet bytesToBits(const string& bytes) {
+    BitSet bits;
+    for (char c : bytes) bits.appendBits((uint8_t)c, 8);
+    return bits;
+}
+
+// Runs one decoder on the input; returns whether it accepted it
+bool runFuzzTarget(int target, const string& input) {
+    const FuzzTrees& trees = fuzzTrees();
+    stringstream in(input);
+    string out;
+    switch (target) {
+        case kFuzzFile: {
+            stringstream sink;
+            return decompressStream(in, sink);
+        }
+        case kFuzzBlocks: {
+            BlockEncoded encoded;
+            return readBlocks(in, encoded) && decompressBlocks(encoded, out, 1);
+        }
+        case kFuzzAdaptive:
+            return decompressAdaptive(in, out);
+        case kFuzzMultiStream: {
+            MultiStreamEncoded encoded;
+            return readMultiStream(in, encoded) && decompressMultiStream(encoded, out);
+        }
+        case kFuzzContext:
+            return decompressContext(in, out);
+        case kFuzzMessage:
+            return decodeMessage(trees.dictionaries, input, out);
+        case kFuzzTreeWalk:
+            return trees.passage.decodeText(bytesToBits(input), false, out);
+        case kFuzzCanonical:
+            return trees.passage.decodeText(bytesToBits(input), true, out);
+        case kFuzzSingleSymbol:
+            return trees.single.decodeText(bytesToBits(input), false, out);
+    }
+    return false;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size == 0) return 0;
+    runFuzzTarget(data[0] % kNumFuzzTargets, string((const char*)data + 1, size - 1));
+    return 0;
+}
+
+#ifndef HUFFMAN_LIBFUZZER
+
+// Hand-made inputs for bugs mutation is unlikely to find, run before the mutated ones
+const pair<int, string> kFuzzSeeds[] = {
+    // Adaptive: 2^32 characters in one raw block of 0xFFFFFFFF bytes, with no block data
+    {kFuzzAdaptive, string("HUA1") + string("\x00\x00\x00\x00\x01\x00\x00\x00", 8)
+                    + string("\xff\xff\xff\xff", 4) + (char)kAdaptiveRaw},
+};
+
+// A valid encoding of text for the given decoder
+string encodeForTarget(int target, const string& text) {
+    const FuzzTrees& trees = fuzzTrees();
+    stringstream out;
+    switch (target) {
+        case kFuzzFile: {
+            stringstream in(text);
+            compressStream(in, out);
+            break;
+        }
+        case kFuzzBlocks:
+            writeBlocks(out, compressBlocks(text, 1, 4096));
+            break;
+        case kFuzzAdaptive:
+            compressAdaptive(text, out, 4096);
+            break;
+        case kFuzzMultiStream:
+            writeMultiStream(out, compressMultiStream(text));
+            break;
+        case kFuzzContext:
+            compressContext(text, out);
+            break;
+        case kFuzzMessage:
+            return encodeMessage(trees.dictionary, text);
+        case kFuzzTreeWalk:
+        case kFuzzCanonical: {
+            // Only the passage's characters have codes
+            string known;
+            for (char c : text) {
+                if (kFuzzPassage.find(c) != string::npos) known += c;
+            }
+            vector<uint8_t> bytes = trees.passage.encodeText(known, target == kFuzzCanonical).copyBytes();
+            return string(bytes.begin(), bytes.end());
+        }
+        case kFuzzSingleSymbol: {
+            vector<uint8_t> bytes = trees.single.encodeText(string(text.size() % 64, 'a')).copyBytes();
+            return string(bytes.begin(), bytes.end());
+        }
+    }
+    return out.str();
+}
+
+// Flips bits, overwrites, truncates or duplicates part of the input
+void mutate(string& data, mt19937& rng) {
+    if (data.empty()) {
+        data.push_back((char)rng());
+        return;
+    }
+    int edits = 1 + (int)(rng() % 4);
+    for (int e = 0; e < edits && !data.empty(); e++) {
+        size_t at = rng() % data.size();
+        switch (rng() % 4) {
+            case 0: data[at] ^= (char)(1 << (rng() % 8)); break;
+            case 1: data[at] = (char)rng(); break;
+            case 2: data.resize(at); break;
+            case 3: data.insert(at, data.substr(at, rng() % 16)); break;
+        }
+    }
+}
+
+// Usage: HuffmanFuzz [iterations] [seed]
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 20000;
+    unsigned seed = argc > 2 ? (unsigned)atol(argv[2]) : 343;
+    mt19937 rng(seed);
+
+    for (const auto& seed : kFuzzSeeds) {
+        if (runFuzzTarget(seed.first, seed.second)) {
+            cout << "Crafted input accepted by target " << seed.first << "\n";
+            return 1;
+        }
+    }
+
+    vector<long> accepted(kNumFuzzTargets, 0), runs(kNumFuzzTargets, 0);
+    for (long i = 0; i < iterations; i++) {
+        int target = (int)(i % kNumFuzzTargets);
+        CorpusKind kind = kAllCorpora[rng() % size(kAllCorpora)];
+        string text = makeCorpus(kind, 1 + rng() % 20000, rng());
+
+        string input = encodeForTarget(target, text);
+        mutate(input, rng);
+        runs[target]++;
+        accepted[target] += runFuzzTarget(target, input);
+    }
+
+    cout << "Fuzzed " << iterations << " mutated inputs, no crashes\n";
+    const char* names[] = {"file", "blocks", "adaptive", "multi-stream", "context", "message",
+                           "tree walk", "canonical", "single symbol"};
+    for (int t = 0; t < kNumFuzzTargets; t++) {
+        cout << "  " << names[t] << ": " << accepted[t] << " of " << runs[t] << " accepted\n";
+    }
+    return 0;
+}
+
+#endif
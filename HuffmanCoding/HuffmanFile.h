@@ -0,0 +1,241 @@
+#ifndef HUFFMANFILE_H
+#define HUFFMANFILE_H
+
+#include "HuffmanTree.h"
+#include "DecodeTable.h"
+#include <array>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <streambuf>
+#include <cstdint>
+
+// Compressed file layout (all integers little-endian):
+//
+//   magic           4 bytes   "HUF1"
+//   flags           1 byte    kNibbleLengths if the code lengths are packed two per byte
+//   original length 8 bytes   number of characters to decode
+//   code lengths    128 bytes as nibbles (high nibble first), otherwise 256 bytes
+//   payload         canonical codes packed MSB-first, last byte zero-padded
+//   checksum        4 bytes   CRC-32 of the original data
+//
+// The decoder rebuilds its DecodeTable from the code lengths alone; no tree is built.
+
+const char kHuffmanMagic[4] = {'H', 'U', 'F', '1'};
+const uint8_t kNibbleLengths = 1;
+
+// Compressors limit codes to 15 bits, so the lengths always pack into nibbles and the
+// decoder never leaves its primary and secondary tables
+const int kContainerMaxCodeLength = 15;
+
+struct HuffmanFileHeader {
+    uint64_t originalLength;
+    std::array<uint8_t, 256> codeLengths;
+};
+
+/**
+ * Updates a CRC-32 (IEEE, as used by zlib) with more data.
+ * @param crc The checksum so far; 0 for the first block.
+ * @return The checksum including data.
+ */
+inline uint32_t crc32Update(uint32_t crc, const char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Forwards everything written to it to another stream, keeping a running CRC-32
+class ChecksumStreamBuf : public std::streambuf {
+public:
+    explicit ChecksumStreamBuf(std::ostream& target) : target(target), crc(0) {}
+
+    uint32_t checksum() const {
+        return crc;
+    }
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        crc = crc32Update(crc, s, (size_t)n);
+        target.write(s, n);
+        return target ? n : 0;
+    }
+
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+    int sync() override {
+        target.flush();
+        return target ? 0 : -1;
+    }
+
+private:
+    std::ostream& target;
+    uint32_t crc;
+};
+
+inline void writeLittleEndian(std::ostream& out, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        out.put((char)(value >> (8 * i)));
+    }
+}
+
+inline bool readLittleEndian(std::istream& in, uint64_t& value, int numBytes) {
+    value = 0;
+    for (int i = 0; i < numBytes; i++) {
+        int byte = in.get();
+        if (byte == EOF) return false;
+        value |= (uint64_t)byte << (8 * i);
+    }
+    return true;
+}
+
+/**
+ * Appends exactly size bytes from in to out. The buffer grows a block at a time as data
+ * arrives, so a corrupt length field fails at end of input instead of allocating it all.
+ */
+template <typename Buffer>  // std::vector<uint8_t> or std::string
+bool readBytes(std::istream& in, Buffer& out, uint64_t size) {
+    while (size > 0) {
+        size_t chunk = (size_t)std::min<uint64_t>(size, kStreamBlockSize);
+        size_t used = out.size();
+        out.resize(used + chunk);
+        if (!in.read((char*)&out[used], (std::streamsize)chunk)) return false;
+        size -= chunk;
+    }
+    return true;
+}
+
+// Flags describing how writeCodeLengths will store these lengths
+inline uint8_t codeLengthFlags(const std::array<uint8_t, 256>& codeLengths) {
+    for (uint8_t len : codeLengths) {
+        if (len > 15) return 0;
+    }
+    return kNibbleLengths;
+}
+
+inline void writeCodeLengths(std::ostream& out, const std::array<uint8_t, 256>& codeLengths) {
+    if (codeLengthFlags(codeLengths) & kNibbleLengths) {
+        for (int i = 0; i < 256; i += 2) {
+            out.put((char)((codeLengths[i] << 4) | codeLengths[i + 1]));
+        }
+    } else {
+        out.write((const char*)codeLengths.data(), 256);
+    }
+}
+
+inline bool readCodeLengths(std::istream& in, int flags, std::array<uint8_t, 256>& codeLengths) {
+    if (flags & kNibbleLengths) {
+        for (int i = 0; i < 256; i += 2) {
+            int packed = in.get();
+            if (packed == EOF) return false;
+            codeLengths[i] = (uint8_t)(packed >> 4);
+            codeLengths[i + 1] = (uint8_t)(packed & 0xF);
+        }
+        return true;
+    }
+    return (bool)in.read((char*)codeLengths.data(), 256);
+}
+
+inline void writeHeader(std::ostream& out, const HuffmanFileHeader& header) {
+    out.write(kHuffmanMagic, 4);
+    out.put((char)codeLengthFlags(header.codeLengths));
+    writeLittleEndian(out, header.originalLength, 8);
+    writeCodeLengths(out, header.codeLengths);
+}
+
+inline bool readHeader(std::istream& in, HuffmanFileHeader& header) {
+    char magic[4];
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kHuffmanMagic)) return false;
+
+    int flags = in.get();
+    return flags != EOF && readLittleEndian(in, header.originalLength, 8)
+           && readCodeLengths(in, flags, header.codeLengths);
+}
+
+/**
+ * Compresses a seekable stream into the format above: one pass to count frequencies and
+ * checksum the input, a second to encode it.
+ * @return false if the input could not be read or the output could not be written.
+ */
+inline bool compressStream(std::istream& in, std::ostream& out) {
+    Histogram counts{};
+    std::vector<char> buffer(kStreamBlockSize);
+    std::istream::pos_type start = in.tellg();
+    uint32_t crc = 0;
+    uint64_t length = 0;
+
+    while (in) {
+        in.read(buffer.data(), buffer.size());
+        size_t got = (size_t)in.gcount();
+        addToHistogram(buffer.data(), got, counts);
+        crc = crc32Update(crc, buffer.data(), got);
+        length += got;
+    }
+    in.clear();
+    if (start == std::istream::pos_type(-1) || !in.seekg(start)) return false;
+
+    HuffmanTree tree;
+    tree.buildTree(histogramToFrequencies(counts));
+    tree.generateCanonicalCodes(kContainerMaxCodeLength);
+
+    HuffmanFileHeader header{length, tree.getCanonicalCodeLengths()};
+    writeHeader(out, header);
+    tree.encodeStream(in, out);
+    writeLittleEndian(out, crc, 4);
+    return (bool)out;
+}
+
+/**
+ * Decompresses a stream written by compressStream. The input must be seekable so the
+ * trailing checksum can be read.
+ * @return false on a malformed header, a corrupt payload or a checksum mismatch.
+ */
+inline bool decompressStream(std::istream& in, std::ostream& out) {
+    HuffmanFileHeader header;
+    if (!readHeader(in, header)) return false;
+
+    DecodeTable table;
+    if (!table.build(header.codeLengths)) return false;
+
+    ChecksumStreamBuf checksumBuf(out);
+    std::ostream checksummed(&checksumBuf);
+    if (!table.decode(in, checksummed, header.originalLength)) return false;
+    checksummed.flush();
+
+    uint64_t expected;
+    in.clear();
+    if (!in.seekg(-4, std::ios::end) || !readLittleEndian(in, expected, 4)) return false;
+    return expected == checksumBuf.checksum() && (bool)out;
+}
+
+inline bool compressFile(const std::string& inputPath, const std::string& outputPath) {
+    std::ifstream in(inputPath, std::ios::binary);
+    std::ofstream out(outputPath, std::ios::binary);
+    return in && out && compressStream(in, out);
+}
+
+inline bool decompressFile(const std::string& inputPath, const std::string& outputPath) {
+    std::ifstream in(inputPath, std::ios::binary);
+    std::ofstream out(outputPath, std::ios::binary);
+    return in && out && decompressStream(in, out);
+}
+
+#endif //HUFFMANFILE_H
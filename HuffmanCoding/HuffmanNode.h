@@ -1,33 +1,31 @@
 #ifndef HUFFMANNODE_H
 #define HUFFMANNODE_H
 
-#include <memory>
+#include <cstdint>
 
+// Node of a Huffman tree stored in a flat array. Children are array indices (-1 for none).
+// Leaves occupy the first slots in character order and internal nodes follow in creation
+// order, so a node's index doubles as its tiebreaker.
 struct HuffmanNode {
     char character;
-    int frequency;
-    int tiebreaker;
-    std::shared_ptr<HuffmanNode> left;
-    std::shared_ptr<HuffmanNode> right;
-
-    HuffmanNode(char ch, int freq, int tie)
-        : character(ch), frequency(freq), tiebreaker(tie), left(nullptr), right(nullptr) {}
-
-    HuffmanNode(int freq, int tie, std::shared_ptr<HuffmanNode> l, std::shared_ptr<HuffmanNode> r)
-        : character('\0'), frequency(freq), tiebreaker(tie), left(l), right(r) {}
+    int64_t frequency;
+    int left;
+    int right;
 
     bool isLeaf() const {
-        return left == nullptr && right == nullptr;
+        return left < 0 && right < 0;
     }
 };
 
-struct HuffmanNodeComparator {
-    bool operator()(const std::shared_ptr<HuffmanNode>& a, const std::shared_ptr<HuffmanNode>& b) const {
-        if (a->frequency != b->frequency) {
-            return a->frequency > b->frequency;  // Min heap by frequency
-        }
-        return a->tiebreaker > b->tiebreaker;  // If tied, use insertion order (smaller tiebreaker first)
+// Largest tree: 256 leaves, 255 internal nodes (or 1 leaf and a dummy parent)
+const int kMaxHuffmanNodes = 512;
+
+// Min-heap order of the original priority queue: by frequency, ties by insertion order
+inline bool huffmanNodeBefore(const HuffmanNode* nodes, int a, int b) {
+    if (nodes[a].frequency != nodes[b].frequency) {
+        return nodes[a].frequency < nodes[b].frequency;
     }
-};
+    return a < b;
+}
 
 #endif //HUFFMANNODE_H
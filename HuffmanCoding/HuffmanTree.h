@@ -2,198 +2,350 @@
 #define HUFFMANTREE_H
 
 #include "BitSet.h"
+#include "BitReader.h"
 #include "HuffmanNode.h"
 #include "Frequency.h"
+#include "DecodeTable.h"
+#include "EncodeTable.h"
+#include "BitStream.h"
+#include "LengthLimit.h"
 #include <map>
-#include <queue>
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
 
 class HuffmanTree {
 private:
-    std::shared_ptr<HuffmanNode> root;
+    std::array<HuffmanNode, kMaxHuffmanNodes> nodes;
+    int numNodes;
+    int root;
     std::map<char, BitSet> codes;
-    std::map<char, BitSet> canonicalCodes;
-    int nextTiebreaker;
+    std::array<uint8_t, 256> canonicalLengths;
+    // BitSet form of the canonical codes, built from canonicalLengths on first request
+    mutable std::map<char, BitSet> canonicalCodes;
+    mutable bool canonicalCodesBuilt;
+    EncodeTable encodeTable;
+    EncodeTable canonicalEncodeTable;
+    DecodeTable canonicalTable;
 
-    void generateCodes(std::shared_ptr<HuffmanNode> node, BitSet currentCode) {
-        if (!node) return;
+    void generateCodes(int node, BitSet currentCode) {
+        if (node < 0) return;
 
-        if (node->isLeaf()) {
-            codes[node->character] = currentCode;
+        if (nodes[node].isLeaf()) {
+            codes[nodes[node].character] = currentCode;
         } else {
             BitSet leftCode = currentCode;
             leftCode.append(false);
-            generateCodes(node->left, leftCode);
+            generateCodes(nodes[node].left, leftCode);
 
             BitSet rightCode = currentCode;
             rightCode.append(true);
-            generateCodes(node->right, rightCode);
+            generateCodes(nodes[node].right, rightCode);
         }
     }
 
+    // Materializes canonicalCodes from canonicalLengths with assignCanonicalCodes
+    void buildCanonicalCodes() const {
+        CanonicalCodes canonical;
+        if (!assignCanonicalCodes(canonicalLengths, canonical)) {
+            throw std::length_error("Huffman code longer than 64 bits");
+        }
+
+        canonicalCodes.clear();
+        for (uint8_t symbol : canonical.sortedSymbols) {
+            BitSet code;
+            code.appendBits(canonical.codes[symbol], canonicalLengths[symbol]);
+            canonicalCodes[(char)symbol] = code;
+        }
+        canonicalCodesBuilt = true;
+    }
+
+    // Table-driven decode straight from the BitSet's words. Each refill gives a 57-bit window,
+    // which is decoded until the next code might not fit in what is left of it.
+    bool decodeCanonical(const BitSet& encoded, std::string& out) const {
+        if (!canonicalTable.isValid() || canonicalTable.getMaxLength() == 0) return false;
+
+        // Sized for the most characters the bits could hold, then trimmed to what was decoded
+        int shortest = canonicalTable.getMaxLength();
+        for (uint8_t len : canonicalLengths) {
+            if (len != 0 && len < shortest) shortest = len;
+        }
+        out.resize(encoded.size() / shortest);
+        char* dest = &out[0];
+        size_t count = 0;
+        bool ok = true;
+
+        int longest = canonicalTable.getMaxLength();
+        BitReader reader(encoded);
+        while (ok && !reader.atEnd()) {
+            reader.refill();
+            do {
+                uint8_t symbol;
+                int len = canonicalTable.decode(reader.peekWindow(), symbol);
+                if (len == 0 || len > reader.available()) {
+                    ok = false;
+                    break;
+                }
+                dest[count++] = (char)symbol;
+                reader.consume(len);
+            } while (reader.available() >= longest);
+        }
+        out.resize(count);
+        return ok;
+    }
+
 public:
-    HuffmanTree() : root(nullptr), nextTiebreaker(0) {}
+    HuffmanTree() : numNodes(0), root(-1), canonicalLengths{}, canonicalCodesBuilt(true) {}
 
     // Step 1: Count character frequencies
     std::map<char, int> countFrequencies(const std::string& text) {
         return ::countFrequencies(text);
     }
 
+    // Step 1 (streaming): count frequencies block by block, then rewind for the encoding pass
+    std::map<char, int> countFrequencies(std::istream& in) {
+        return ::countFrequencies(in);
+    }
+
     // Step 2: Build Huffman tree
+    // Two-queue merge over a fixed node array: leaves sorted by (frequency, insertion order) in
+    // one queue, merged nodes in another. Merged frequencies never decrease, so the second queue
+    // stays sorted and the smaller front is always the node a priority queue would pop next.
     void buildTree(const std::map<char, int>& frequencies) {
-        root = nullptr;
+        root = -1;
+        numNodes = 0;
         codes.clear();
+        canonicalLengths.fill(0);
         canonicalCodes.clear();
-        nextTiebreaker = 0;
+        canonicalCodesBuilt = true;
+        encodeTable = EncodeTable();
+        canonicalEncodeTable = EncodeTable();
+        canonicalTable = DecodeTable();
 
         if (frequencies.empty()) return;
 
-        std::priority_queue<std::shared_ptr<HuffmanNode>,
-                          std::vector<std::shared_ptr<HuffmanNode>>,
-                          HuffmanNodeComparator> pq;
-
-        // Populate priority queue in map order (sorted by character)
+        // Leaves in map order (sorted by character); the index is the tiebreaker
         for (const auto& pair : frequencies) {
-            char ch = pair.first;
-            int freq = pair.second;
-            pq.push(std::make_shared<HuffmanNode>(ch, freq, nextTiebreaker++));
+            nodes[numNodes++] = HuffmanNode{pair.first, pair.second, -1, -1};
         }
+        int numLeaves = numNodes;
 
         // Handle single character case
-        if (pq.size() == 1) {
-            auto lone = pq.top();
-            pq.pop();
+        if (numLeaves == 1) {
             // Create a dummy parent so the character has at least one bit (0)
-            root = std::make_shared<HuffmanNode>(lone->frequency, nextTiebreaker++, lone, nullptr);
+            nodes[numNodes] = HuffmanNode{'\0', nodes[0].frequency, 0, -1};
+            root = numNodes++;
             return;
         }
 
+        std::array<int, 256> leafOrder;
+        for (int i = 0; i < numLeaves; i++) leafOrder[i] = i;
+        std::sort(leafOrder.begin(), leafOrder.begin() + numLeaves, [this](int a, int b) {
+            return huffmanNodeBefore(nodes.data(), a, b);
+        });
+
+        int nextLeaf = 0;
+        int nextMerged = numLeaves;
+        auto popSmallest = [&]() {
+            if (nextLeaf < numLeaves
+                && (nextMerged == numNodes || huffmanNodeBefore(nodes.data(), leafOrder[nextLeaf], nextMerged))) {
+                return leafOrder[nextLeaf++];
+            }
+            return nextMerged++;
+        };
+
         // Build tree
-        while (pq.size() > 1) {
-            auto left = pq.top();  // First dequeued is left child
-            pq.pop();
-            auto right = pq.top(); // Second dequeued is right child
-            pq.pop();
+        while (numLeaves - nextLeaf + numNodes - nextMerged > 1) {
+            int left = popSmallest();   // First dequeued is left child
+            int right = popSmallest();  // Second dequeued is right child
+            nodes[numNodes++] = HuffmanNode{'\0', nodes[left].frequency + nodes[right].frequency, left, right};
+        }
+
+        root = numNodes - 1;
+    }
 
-            int combinedFreq = left->frequency + right->frequency;
-            auto parent = std::make_shared<HuffmanNode>(combinedFreq, nextTiebreaker++, left, right);
-            pq.push(parent);
+    // Leaf frequencies indexed by unsigned char (0 = character not present)
+    std::array<uint64_t, 256> getFrequencies() const {
+        std::array<uint64_t, 256> frequencies{};
+        for (int i = 0; i < numNodes; i++) {
+            if (nodes[i].isLeaf()) {
+                frequencies[(uint8_t)nodes[i].character] = (uint64_t)std::max<int64_t>(nodes[i].frequency, 1);
+            }
         }
+        return frequencies;
+    }
 
-        root = pq.top();
+    // Code lengths read straight off the node array (depth of each leaf), indexed by unsigned char
+    std::array<uint8_t, 256> getCodeLengths() const {
+        std::array<uint8_t, 256> lengths{};
+        std::array<uint8_t, kMaxHuffmanNodes> depth{};
+        // Parents are created after their children, so walking down from the root visits
+        // every parent before its children
+        for (int i = root; i >= 0; i--) {
+            const HuffmanNode& node = nodes[i];
+            if (node.isLeaf()) {
+                lengths[(uint8_t)node.character] = depth[i];
+            } else {
+                if (node.left >= 0) depth[node.left] = depth[i] + 1;
+                if (node.right >= 0) depth[node.right] = depth[i] + 1;
+            }
+        }
+        return lengths;
     }
 
     // Step 3: Generate codes
     void generateCodes() {
         codes.clear();
-        if (!root) return;
+        if (root < 0) return;
         BitSet empty;
         generateCodes(root, empty);
+        encodeTable.build(codes);
     }
 
     // Step 4: Generate canonical codes
-    void generateCanonicalCodes() {
-        if (codes.empty()) return;
-        struct CodeInfo {
-            char character;
-            int numBits;
-        };
+    // With maxCodeLength > 0, codes longer than that are re-balanced with package-merge so
+    // decode tables stay small; otherwise the lengths come straight from the tree. Codes are
+    // assigned by counting lengths (bl_count / next_code) straight into the flat encode and
+    // decode tables, so this does not need generateCodes() and allocates no BitSets.
+    // Returns false if maxCodeLength bits cannot give every character its own code; the
+    // canonical codes then keep the tree's own (unlimited) lengths.
+    bool generateCanonicalCodes(int maxCodeLength = 0) {
+        if (root < 0) return true;
 
-        std::vector<CodeInfo> codeInfo;
-        for (const auto& pair : codes) {
-            char ch = pair.first;
-            const BitSet& bitset = pair.second;
-            codeInfo.push_back({ch, bitset.size()});
+        bool ok = true;
+        std::array<uint8_t, 256> lengths = getCodeLengths();
+        if (maxCodeLength > 0 && *std::max_element(lengths.begin(), lengths.end()) > maxCodeLength) {
+            std::array<uint8_t, 256> limited;
+            ok = limitCodeLengths(getFrequencies(), maxCodeLength, limited);
+            if (ok) lengths = limited;
         }
 
-        // Sort by length, then by character
-        std::sort(codeInfo.begin(), codeInfo.end(), [](const CodeInfo& a, const CodeInfo& b) {
-            if (a.numBits != b.numBits) {
-                return a.numBits < b.numBits;
-            }
-            return a.character < b.character;
-        });
-
-        // Assign canonical codes
+        canonicalLengths = lengths;
         canonicalCodes.clear();
-        int currentCode = 0;
-        int currentLength = 0;
-
-        for (const auto& info : codeInfo) {
-            if (info.numBits > currentLength) {
-                currentCode <<= (info.numBits - currentLength);
-                currentLength = info.numBits;
-            }
+        canonicalCodesBuilt = false;
+        canonicalEncodeTable.build(lengths);
+        canonicalTable.build(lengths);
 
-            BitSet canonical;
-            for (int i = currentLength - 1; i >= 0; i--) {
-                canonical.append((currentCode >> i) & 1);
-            }
-            canonicalCodes[info.character] = canonical;
-            currentCode++;
-        }
+        // Codes too long for the table are encoded from the BitSets instead, so build them now
+        if (!canonicalEncodeTable.isValid()) buildCanonicalCodes();
+        return ok;
     }
 
     // Step 5: Encode text
-    BitSet encodeText(const std::string& text, bool useCanonical = false) {
+    BitSet encodeText(const std::string& text, bool useCanonical = false) const {
         BitSet encoded;
+        const EncodeTable& table = useCanonical ? canonicalEncodeTable : encodeTable;
+        if (table.isValid()) {
+            table.encode(text.data(), text.size(), encoded);
+            return encoded;
+        }
+
         const auto& codesToUse = useCanonical ? canonicalCodes : codes;
         if (codesToUse.empty() && !text.empty()) return encoded; // Should not happen if tree built
 
+        // Codes too long for the table (only possible on extremely skewed input)
         for (char c : text) {
             encoded.append(codesToUse.at(c));
         }
         return encoded;
     }
 
-    // Step 6: Decode text (Round-trip)
-    std::string decodeText(const BitSet& encoded, bool useCanonical = false) {
-        if (!root || encoded.size() == 0) return "";
+    // Step 5 (streaming): encode a stream with the canonical codes in fixed-size blocks.
+    // Returns the number of bits written; the last byte is zero-padded.
+    // Throws std::out_of_range on a character that has no code, like encodeText.
+    uint64_t encodeStream(std::istream& in, std::ostream& out) const {
+        BitOutputStream bits(out);
+        std::vector<char> buffer(kStreamBlockSize);
+        while (in) {
+            in.read(buffer.data(), buffer.size());
+            size_t got = (size_t)in.gcount();
+            for (size_t i = 0; i < got; i++) {
+                uint8_t symbol = (uint8_t)buffer[i];
+                int len = canonicalEncodeTable.getLength(symbol);
+                if (len == 0) {
+                    throw std::out_of_range("encodeStream: character has no code");
+                }
+                bits.writeBits(canonicalEncodeTable.getBits(symbol), len);
+            }
+        }
+        bits.flush();
+        return bits.bitsWritten();
+    }
 
+    // Step 6 (streaming): decode numSymbols characters from a stream written by encodeStream
+    bool decodeStream(std::istream& in, std::ostream& out, uint64_t numSymbols) const {
+        return canonicalTable.decode(in, out, numSymbols);
+    }
+
+    // Step 6: Decode text (Round-trip). Malformed input stops the decode; use the overload
+    // below to find out whether that happened.
+    std::string decodeText(const BitSet& encoded, bool useCanonical = false) const {
         std::string decoded = "";
-        
+        decodeText(encoded, useCanonical, decoded);
+        return decoded;
+    }
+
+    /**
+     * Decodes encoded into out, checking every code.
+     * @return false if the bits contain a sequence that is not a code, or end partway through
+     * one; out then holds the characters decoded before the error.
+     */
+    bool decodeText(const BitSet& encoded, bool useCanonical, std::string& out) const {
+        out.clear();
+        if (encoded.size() == 0) return true;
+        if (root < 0) return false;
+
         if (useCanonical) {
-            // To decode canonical, we map bitsets back to characters
-            std::map<std::string, char> reverseMap;
-            for (const auto& pair : canonicalCodes) {
-                reverseMap[pair.second.toBinaryString()] = pair.first;
-            }
+            return decodeCanonical(encoded, out);
+        }
 
-            std::string currentBits = "";
-            for (int i = 0; i < encoded.size(); i++) {
-                currentBits += encoded.getBit(i) ? '1' : '0';
-                if (reverseMap.count(currentBits)) {
-                    decoded += reverseMap[currentBits];
-                    currentBits = "";
-                }
-            }
-        } else {
-            // Standard decoding using tree traversal
-            std::shared_ptr<HuffmanNode> current = root;
-            for (int i = 0; i < encoded.size(); i++) {
-                if (encoded.getBit(i)) {
-                    current = current->right;
-                } else {
-                    current = current->left;
-                }
+        // Standard decoding using tree traversal, a window of bits at a time. A missing child
+        // (such as the empty right branch under a single-symbol tree) is an invalid code.
+        BitReader reader(encoded);
+        int current = root;
+        while (!reader.atEnd()) {
+            reader.refill();
+            uint64_t window = reader.peekWindow();
+            int n = reader.available();
+            for (int i = 0; i < n; i++) {
+                const HuffmanNode& node = nodes[current];
+                current = (window >> 63) ? node.right : node.left;
+                window <<= 1;
+                if (current < 0) return false;
 
-                if (current->isLeaf()) {
-                    decoded += current->character;
+                if (nodes[current].isLeaf()) {
+                    out += nodes[current].character;
                     current = root;
                 }
             }
+            reader.consume(n);
         }
-        return decoded;
+        return current == root;
     }
 
     const std::map<char, BitSet>& getCodes() const {
         return codes;
     }
 
+    // Built on the first call after generateCanonicalCodes; like any first use of a lazily
+    // filled cache, that call must not race with another
     const std::map<char, BitSet>& getCanonicalCodes() const {
+        if (!canonicalCodesBuilt) buildCanonicalCodes();
         return canonicalCodes;
     }
+
+    // Canonical code lengths indexed by unsigned char (0 = character not present)
+    const std::array<uint8_t, 256>& getCanonicalCodeLengths() const {
+        return canonicalLengths;
+    }
+
+    const DecodeTable& getCanonicalTable() const {
+        return canonicalTable;
+    }
+
+    const EncodeTable& getCanonicalEncodeTable() const {
+        return canonicalEncodeTable;
+    }
 };
 
 #endif //HUFFMANTREE_H
@@ -0,0 +1,82 @@
+#ifndef LENGTHLIMIT_H
+#define LENGTHLIMIT_H
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * Computes optimal code lengths no longer than maxLength bits using package-merge.
+ *
+ * Level 0 holds the symbols sorted by frequency; every higher level merges the symbols with
+ * adjacent pairs ("packages") of the level below. The cheapest 2n - 2 items of the top level
+ * pick out the code lengths: each time a symbol is chosen at some level its code gets one bit
+ * longer. Because every level keeps the symbols in sorted order, the symbols chosen at a level
+ * are always a prefix of the sorted symbols, so only the item kinds need to be remembered.
+ *
+ * @param frequencies Frequency of each byte value; zero means the symbol is absent.
+ * @param maxLength Longest allowed code, in bits.
+ * @param lengths Receives the code length of each byte value (0 for absent symbols).
+ * @return false if maxLength bits cannot give every present symbol its own code.
+ */
+inline bool limitCodeLengths(const std::array<uint64_t, 256>& frequencies, int maxLength,
+                             std::array<uint8_t, 256>& lengths) {
+    lengths.fill(0);
+
+    std::vector<int> symbols;
+    for (int i = 0; i < 256; i++) {
+        if (frequencies[i] > 0) symbols.push_back(i);
+    }
+    size_t n = symbols.size();
+    if (n == 0) return true;
+    if (n == 1) {
+        lengths[symbols[0]] = 1;
+        return maxLength >= 1;
+    }
+    if (maxLength < 1 || maxLength >= 64 || ((uint64_t)1 << maxLength) < n) return false;
+
+    std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) {
+        return frequencies[a] < frequencies[b];
+    });
+
+    // isPackage[level][i]: whether the i-th cheapest item at that level is a package
+    std::vector<std::vector<bool>> isPackage(maxLength);
+    std::vector<uint64_t> weights;
+    for (int level = 0; level < maxLength; level++) {
+        std::vector<uint64_t> packages;
+        for (size_t i = 0; i + 1 < weights.size(); i += 2) {
+            packages.push_back(weights[i] + weights[i + 1]);
+        }
+
+        std::vector<uint64_t> merged;
+        size_t s = 0, p = 0;
+        while (s < n || p < packages.size()) {
+            // Symbols win ties, which keeps lengths of equal-frequency symbols together
+            if (p == packages.size() || (s < n && frequencies[symbols[s]] <= packages[p])) {
+                merged.push_back(frequencies[symbols[s++]]);
+                isPackage[level].push_back(false);
+            } else {
+                merged.push_back(packages[p++]);
+                isPackage[level].push_back(true);
+            }
+        }
+        weights.swap(merged);
+    }
+
+    size_t take = 2 * n - 2;
+    for (int level = maxLength - 1; level >= 0 && take > 0; level--) {
+        size_t symbolsTaken = 0, packagesTaken = 0;
+        for (size_t i = 0; i < take; i++) {
+            if (isPackage[level][i]) packagesTaken++;
+            else symbolsTaken++;
+        }
+        for (size_t i = 0; i < symbolsTaken; i++) {
+            lengths[symbols[i]]++;
+        }
+        take = 2 * packagesTaken;
+    }
+    return true;
+}
+
+#endif //LENGTHLIMIT_H
@@ -0,0 +1,162 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <streambuf>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A whole file mapped into memory (POSIX). Empty files are valid and have a null data pointer,
+// since a zero-length mapping is not allowed.
+//
+// A file made by create() is written under a temporary name in the same directory and only
+// renamed over the real path by commit(), so a failed write never touches an existing file.
+class MappedFile {
+public:
+    MappedFile() : fd(-1), mapping(nullptr), length(0), writable(false) {}
+
+    // An uncommitted created file is discarded
+    ~MappedFile() {
+        if (!temporaryPath.empty()) discard();
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps an existing file read-only. Returns false if it cannot be opened or mapped.
+    bool openRead(const std::string& path) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) return fail();
+        length = (size_t)info.st_size;
+        if (length == 0) return true;
+
+        mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) return fail();
+        madvise(mapping, length, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    // Maps a new temporary file of exactly size bytes for writing; commit() moves it to path.
+    // Returns false (leaving nothing behind) if it cannot be created, sized or mapped.
+    bool create(const std::string& path, size_t size) {
+        close();
+        std::string pattern = path + ".XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        fd = mkstemp(name.data());
+        if (fd < 0) return false;
+        temporaryPath = name.data();
+        targetPath = path;
+
+        // mkstemp makes the file private; give it the permissions open(path, O_CREAT, 0644) would
+        mode_t mask = umask(0);
+        umask(mask);
+        if (fchmod(fd, 0644 & ~mask) != 0 || ftruncate(fd, (off_t)size) != 0) return failAndDiscard();
+        length = size;
+        writable = true;
+        if (length == 0) return true;
+
+        mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) return failAndDiscard();
+        return true;
+    }
+
+    // Writes a created file back and renames it over its path. Returns false (discarding the
+    // file and leaving the path as it was) if either step fails.
+    bool commit() {
+        if (temporaryPath.empty()) return false;
+        if (!close() || std::rename(temporaryPath.c_str(), targetPath.c_str()) != 0) return failAndDiscard();
+        temporaryPath.clear();
+        return true;
+    }
+
+    // Closes a created file and deletes it, for when its contents turned out to be bad.
+    void discard() {
+        close();
+        if (!temporaryPath.empty()) ::unlink(temporaryPath.c_str());
+        temporaryPath.clear();
+    }
+
+    // Whether path names the file this object has open (the same device and inode)
+    bool isSameFile(const std::string& path) const {
+        struct stat mine, other;
+        return fd >= 0 && fstat(fd, &mine) == 0 && stat(path.c_str(), &other) == 0
+               && mine.st_dev == other.st_dev && mine.st_ino == other.st_ino;
+    }
+
+    // Unmaps and closes; changes to a created file are written back by the kernel. A created
+    // file keeps its temporary name until commit(). Returns false if writing back failed.
+    bool close() {
+        bool ok = true;
+        if (mapping != nullptr) {
+            if (writable) ok = msync(mapping, length, MS_SYNC) == 0;
+            munmap(mapping, length);
+        }
+        if (fd >= 0) ok = ::close(fd) == 0 && ok;
+        fd = -1;
+        mapping = nullptr;
+        length = 0;
+        writable = false;
+        return ok;
+    }
+
+    const uint8_t* data() const {
+        return (const uint8_t*)mapping;
+    }
+
+    uint8_t* mutableData() {
+        return writable ? (uint8_t*)mapping : nullptr;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    int fd;
+    void* mapping;
+    size_t length;
+    bool writable;
+    std::string temporaryPath;   // a created file not yet committed or discarded
+    std::string targetPath;
+
+    bool fail() {
+        mapping = nullptr;
+        close();
+        return false;
+    }
+
+    bool failAndDiscard() {
+        fail();
+        discard();
+        return false;
+    }
+};
+
+// Read-only std::streambuf over a block of memory, so the stream-based header readers can
+// parse a mapped file without copying it
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const uint8_t* data, size_t size) {
+        char* begin = (char*)data;
+        setg(begin, begin, begin + size);
+    }
+
+    // Bytes consumed so far
+    size_t position() const {
+        return (size_t)(gptr() - eback());
+    }
+};
+
+#endif //MAPPEDFILE_H
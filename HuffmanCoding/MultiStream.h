@@ -0,0 +1,194 @@
+#ifndef MULTISTREAM_H
+#define MULTISTREAM_H
+
+#include "HuffmanTree.h"
+#include "HuffmanFile.h"
+#include "DecodeTable.h"
+#include "EncodeTable.h"
+#include "Frequency.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <cstring>
+
+// Four-stream layout (all integers little-endian):
+//
+//   magic           4 bytes   "HU4S"
+//   flags           1 byte    as in HuffmanFile.h
+//   original length 8 bytes
+//   code lengths    as in HuffmanFile.h
+//   jump table      per stream: 8-byte byte offset into the payload, 8-byte bit count
+//   payload         the four streams, each starting on a byte boundary
+//
+// The input is cut into four consecutive segments (the last one takes the remainder) and each
+// is coded as its own bitstream. Decoding steps all four streams in one loop; their table
+// lookups do not depend on each other, so an out-of-order core overlaps them.
+// Input shorter than four characters lands entirely in the last stream.
+
+const char kMultiStreamMagic[4] = {'H', 'U', '4', 'S'};
+const int kNumStreams = 4;
+
+struct MultiStreamEncoded {
+    uint64_t originalLength;
+    std::array<uint8_t, 256> codeLengths;
+    std::array<uint64_t, kNumStreams> streamOffsets;
+    std::array<uint64_t, kNumStreams> streamBits;
+    std::vector<uint8_t> payload;
+};
+
+inline MultiStreamEncoded compressMultiStream(const std::string& text) {
+    MultiStreamEncoded encoded{text.size(), {}, {}, {}, {}};
+
+    HuffmanTree tree;
+    tree.buildTree(countFrequencies(text));
+    tree.generateCanonicalCodes(kContainerMaxCodeLength);
+    encoded.codeLengths = tree.getCanonicalCodeLengths();
+
+    size_t segment = text.size() / kNumStreams;
+    for (int s = 0; s < kNumStreams; s++) {
+        size_t start = s * segment;
+        size_t length = s + 1 < kNumStreams ? segment : text.size() - start;
+        BitSet bits;
+        tree.getCanonicalEncodeTable().encode(text.data() + start, length, bits);
+        const std::vector<uint8_t>& bytes = bits.getBytes();
+
+        encoded.streamOffsets[s] = encoded.payload.size();
+        encoded.streamBits[s] = bits.size();
+        encoded.payload.insert(encoded.payload.end(), bytes.begin(), bytes.end());
+    }
+    encoded.payload.resize(encoded.payload.size() + kWindowPadding, 0);
+    return encoded;
+}
+
+/**
+ * Decodes the four streams in lockstep into out.
+ * @return false on an invalid code, a stream overrunning its bit count, or a bad jump table.
+ */
+inline bool decompressMultiStream(const MultiStreamEncoded& encoded, std::string& out) {
+    out.clear();
+    DecodeTable table;
+    if (!table.build(encoded.codeLengths)) return false;
+    if (encoded.payload.size() < kWindowPadding) return false;
+
+    size_t payloadBytes = encoded.payload.size() - kWindowPadding;
+    std::array<uint64_t, kNumStreams> end;
+    uint64_t totalBits = 0;
+    for (int s = 0; s < kNumStreams; s++) {
+        if (encoded.streamOffsets[s] > payloadBytes || encoded.streamBits[s] > (uint64_t)payloadBytes * 8) return false;
+        end[s] = encoded.streamOffsets[s] * 8 + encoded.streamBits[s];
+        if ((end[s] + 7) / 8 > payloadBytes) return false;
+        totalBits += encoded.streamBits[s];
+    }
+    // Every character takes at least one bit, so this bounds what a corrupt header can allocate
+    if (encoded.originalLength > totalBits) return false;
+
+    size_t segment = encoded.originalLength / kNumStreams;
+    std::string text(encoded.originalLength, '\0');
+    const uint8_t* data = encoded.payload.data();
+
+    // Each window holds at least 57 valid bits, enough for this many codes between reloads
+    size_t perReload = table.getMaxLength() > 0 ? 57 / table.getMaxLength() : 1;
+
+    // One local per stream rather than arrays, so the compiler keeps all four in registers
+    // even though the char stores below could alias anything
+    uint64_t position0 = encoded.streamOffsets[0] * 8;
+    uint64_t position1 = encoded.streamOffsets[1] * 8;
+    uint64_t position2 = encoded.streamOffsets[2] * 8;
+    uint64_t position3 = encoded.streamOffsets[3] * 8;
+    char* dest0 = &text[0];
+    char* dest1 = dest0 + segment;
+    char* dest2 = dest1 + segment;
+    char* dest3 = dest2 + segment;
+
+    // Invalid codes decode as length 0 and are caught once after the loop
+    bool valid = true;
+    size_t i = 0;
+    while (i < segment) {
+        size_t count = std::min(perReload, segment - i);
+        uint64_t window0 = loadWindow(data, position0);
+        uint64_t window1 = loadWindow(data, position1);
+        uint64_t window2 = loadWindow(data, position2);
+        uint64_t window3 = loadWindow(data, position3);
+        for (size_t k = 0; k < count; k++, i++) {
+            uint8_t symbol0, symbol1, symbol2, symbol3;
+            int len0 = table.decode(window0, symbol0);
+            int len1 = table.decode(window1, symbol1);
+            int len2 = table.decode(window2, symbol2);
+            int len3 = table.decode(window3, symbol3);
+            dest0[i] = (char)symbol0;
+            dest1[i] = (char)symbol1;
+            dest2[i] = (char)symbol2;
+            dest3[i] = (char)symbol3;
+
+            valid &= (len0 != 0) & (len1 != 0) & (len2 != 0) & (len3 != 0);
+            window0 <<= len0;
+            window1 <<= len1;
+            window2 <<= len2;
+            window3 <<= len3;
+            position0 += len0;
+            position1 += len1;
+            position2 += len2;
+            position3 += len3;
+        }
+
+        // Stop before the next reload could run past the padding
+        if ((position0 > end[0]) | (position1 > end[1]) | (position2 > end[2]) | (position3 > end[3])) {
+            return false;
+        }
+    }
+
+    // The last stream's extra characters
+    size_t extra = encoded.originalLength - kNumStreams * segment;
+    for (size_t k = segment; k < segment + extra; k++) {
+        uint8_t symbol;
+        int len = table.decode(loadWindow(data, position3), symbol);
+        valid &= len != 0;
+        dest3[k] = (char)symbol;
+        position3 += len;
+        if (position3 > end[3]) return false;
+    }
+
+    if (!valid) return false;
+    out.swap(text);
+    return true;
+}
+
+inline void writeMultiStream(std::ostream& out, const MultiStreamEncoded& encoded) {
+    out.write(kMultiStreamMagic, 4);
+    out.put((char)codeLengthFlags(encoded.codeLengths));
+    writeLittleEndian(out, encoded.originalLength, 8);
+    writeCodeLengths(out, encoded.codeLengths);
+    for (int s = 0; s < kNumStreams; s++) {
+        writeLittleEndian(out, encoded.streamOffsets[s], 8);
+        writeLittleEndian(out, encoded.streamBits[s], 8);
+    }
+    out.write((const char*)encoded.payload.data(),
+              (std::streamsize)(encoded.payload.size() - kWindowPadding));
+}
+
+inline bool readMultiStream(std::istream& in, MultiStreamEncoded& encoded) {
+    char magic[4];
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kMultiStreamMagic)) return false;
+
+    int flags = in.get();
+    if (flags == EOF || !readLittleEndian(in, encoded.originalLength, 8)
+        || !readCodeLengths(in, flags, encoded.codeLengths)) {
+        return false;
+    }
+
+    uint64_t payloadBytes = 0;
+    for (int s = 0; s < kNumStreams; s++) {
+        if (!readLittleEndian(in, encoded.streamOffsets[s], 8)
+            || !readLittleEndian(in, encoded.streamBits[s], 8)) {
+            return false;
+        }
+        payloadBytes = std::max(payloadBytes, encoded.streamOffsets[s] + (encoded.streamBits[s] + 7) / 8);
+    }
+
+    encoded.payload.clear();
+    if (!readBytes(in, encoded.payload, payloadBytes)) return false;
+    encoded.payload.resize(encoded.payload.size() + kWindowPadding, 0);
+    return true;
+}
+
+#endif //MULTISTREAM_H
@@ -0,0 +1,217 @@
+#ifndef STATICDICTIONARY_H
+#define STATICDICTIONARY_H
+
+#include "HuffmanTree.h"
+#include "HuffmanFile.h"
+#include "DecodeTable.h"
+#include "EncodeTable.h"
+#include "Frequency.h"
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+// Pretrained tables for small messages, where a per-message tree and code table would cost
+// more than the coding saves. A dictionary is trained once from a sample corpus, stored under
+// a numeric ID, and both sides code messages against it with no tree building.
+//
+// Dictionary file layout (all integers little-endian):
+//
+//   magic           4 bytes   "HUD1"
+//   dictionary ID   4 bytes
+//   flags           1 byte    as in HuffmanFile.h
+//   code lengths    as in HuffmanFile.h
+//
+// Message layout:
+//
+//   dictionary ID   4 bytes
+//   length          4 bytes   number of characters, so messages are under 4 GB
+//   payload         canonical codes packed MSB-first, last byte zero-padded
+
+const char kDictionaryMagic[4] = {'H', 'U', 'D', '1'};
+const size_t kMessageHeaderSize = 8;
+
+class StaticDictionary {
+public:
+    StaticDictionary() : id(0), codeLengths{}, maxCodeLength(0) {}
+
+    // Installs a table. Returns false if the lengths do not describe a usable prefix code.
+    bool setCodeLengths(uint32_t dictionaryId, const std::array<uint8_t, 256>& lengths) {
+        id = dictionaryId;
+        codeLengths = lengths;
+        maxCodeLength = *std::max_element(lengths.begin(), lengths.end());
+        return encodeTable.build(lengths) && decodeTable.build(lengths);
+    }
+
+    uint32_t getId() const {
+        return id;
+    }
+
+    const std::array<uint8_t, 256>& getCodeLengths() const {
+        return codeLengths;
+    }
+
+    int getMaxCodeLength() const {
+        return maxCodeLength;
+    }
+
+    const EncodeTable& getEncodeTable() const {
+        return encodeTable;
+    }
+
+    const DecodeTable& getDecodeTable() const {
+        return decodeTable;
+    }
+
+private:
+    uint32_t id;
+    std::array<uint8_t, 256> codeLengths;
+    int maxCodeLength;
+    EncodeTable encodeTable;
+    DecodeTable decodeTable;
+};
+
+/**
+ * Trains a dictionary from a sample corpus. Every byte value gets a code, so any message can
+ * be encoded; bytes missing from the corpus just get long ones.
+ * Throws std::runtime_error if no usable table can be built from the corpus.
+ * @param id The ID messages will carry.
+ * @param corpus Sample text representative of the messages.
+ * @param size Number of characters in corpus.
+ */
+inline StaticDictionary trainDictionary(uint32_t id, const char* corpus, size_t size) {
+    Histogram counts{};
+    addToHistogram(corpus, size, counts);
+    for (uint64_t& count : counts) count++;
+
+    HuffmanTree tree;
+    tree.buildTree(histogramToFrequencies(counts));
+    StaticDictionary dictionary;
+    if (!tree.generateCanonicalCodes(kContainerMaxCodeLength)
+        || !dictionary.setCodeLengths(id, tree.getCanonicalCodeLengths())) {
+        throw std::runtime_error("trainDictionary: corpus gives no usable code table");
+    }
+    return dictionary;
+}
+
+inline StaticDictionary trainDictionary(uint32_t id, const std::string& corpus) {
+    return trainDictionary(id, corpus.data(), corpus.size());
+}
+
+inline void writeDictionary(std::ostream& out, const StaticDictionary& dictionary) {
+    out.write(kDictionaryMagic, 4);
+    writeLittleEndian(out, dictionary.getId(), 4);
+    out.put((char)codeLengthFlags(dictionary.getCodeLengths()));
+    writeCodeLengths(out, dictionary.getCodeLengths());
+}
+
+inline bool readDictionary(std::istream& in, StaticDictionary& dictionary) {
+    char magic[4];
+    uint64_t id;
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, kDictionaryMagic)
+        || !readLittleEndian(in, id, 4)) {
+        return false;
+    }
+
+    std::array<uint8_t, 256> lengths;
+    int flags = in.get();
+    return flags != EOF && readCodeLengths(in, flags, lengths)
+           && dictionary.setCodeLengths((uint32_t)id, lengths);
+}
+
+// Where a dictionary with this ID lives inside a dictionary directory
+inline std::string dictionaryPath(const std::string& directory, uint32_t id) {
+    return directory + "/" + std::to_string(id) + ".hufdict";
+}
+
+inline bool saveDictionary(const std::string& directory, const StaticDictionary& dictionary) {
+    std::ofstream out(dictionaryPath(directory, dictionary.getId()), std::ios::binary);
+    writeDictionary(out, dictionary);
+    return (bool)out;
+}
+
+inline bool loadDictionary(const std::string& directory, uint32_t id, StaticDictionary& dictionary) {
+    std::ifstream in(dictionaryPath(directory, id), std::ios::binary);
+    return in && readDictionary(in, dictionary) && dictionary.getId() == id;
+}
+
+// The dictionaries a decoder knows about, looked up by the ID in each message
+class DictionarySet {
+public:
+    void add(const StaticDictionary& dictionary) {
+        dictionaries[dictionary.getId()] = dictionary;
+    }
+
+    // Returns nullptr for an unknown ID
+    const StaticDictionary* find(uint32_t id) const {
+        auto it = dictionaries.find(id);
+        return it == dictionaries.end() ? nullptr : &it->second;
+    }
+
+private:
+    std::map<uint32_t, StaticDictionary> dictionaries;
+};
+
+/**
+ * Encodes one message against a dictionary in a single table-driven pass, packing the codes
+ * straight into the message.
+ * @return The message header followed by the packed codes.
+ * Throws std::length_error if the message is too long for its 4-byte length field.
+ */
+inline std::string encodeMessage(const StaticDictionary& dictionary, const char* data, size_t size) {
+    if (size > UINT32_MAX) throw std::length_error("encodeMessage: message of 4 GB or more");
+
+    // Room for every character at the longest code, trimmed once the real size is known
+    size_t maxPayload = (size_t)(((uint64_t)size * dictionary.getMaxCodeLength() + 7) / 8);
+    std::string message(kMessageHeaderSize + maxPayload, '\0');
+    for (int i = 0; i < 4; i++) {
+        message[i] = (char)(dictionary.getId() >> (8 * i));
+        message[4 + i] = (char)((uint64_t)size >> (8 * i));
+    }
+    uint64_t bits = dictionary.getEncodeTable().encode(data, size, (uint8_t*)&message[kMessageHeaderSize]);
+    message.resize(kMessageHeaderSize + (size_t)((bits + 7) / 8));
+    return message;
+}
+
+inline std::string encodeMessage(const StaticDictionary& dictionary, const std::string& text) {
+    return encodeMessage(dictionary, text.data(), text.size());
+}
+
+inline uint32_t loadLittleEndian32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)(uint8_t)data[i] << (8 * i);
+    return value;
+}
+
+/**
+ * Decodes a message written by encodeMessage with whichever known dictionary it names.
+ * @return false on a short header, an unknown dictionary, or an invalid or truncated payload.
+ */
+inline bool decodeMessage(const DictionarySet& dictionaries, const char* message, size_t size, std::string& out) {
+    out.clear();
+    if (size < kMessageHeaderSize) return false;
+    const StaticDictionary* dictionary = dictionaries.find(loadLittleEndian32(message));
+    if (dictionary == nullptr) return false;
+
+    size_t length = loadLittleEndian32(message + 4);
+    size_t numBits = (size - kMessageHeaderSize) * 8;
+    if (length > numBits) return false;
+
+    std::string text(length, '\0');
+    if (!dictionary->getDecodeTable().decode((const uint8_t*)message + kMessageHeaderSize, 0, numBits,
+                                             &text[0], length)) {
+        return false;
+    }
+    out.swap(text);
+    return true;
+}
+
+inline bool decodeMessage(const DictionarySet& dictionaries, const std::string& message, std::string& out) {
+    return decodeMessage(dictionaries, message.data(), message.size(), out);
+}
+
+#endif //STATICDICTIONARY_H
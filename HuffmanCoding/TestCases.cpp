@@ -1,8 +1,19 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
 #include "BitSet.h"
 #include "HuffmanTree.h"
+#include "HuffmanFile.h"
+#include "BlockCodec.h"
+#include "AdaptiveCodec.h"
+#include "MultiStream.h"
+#include "StaticDictionary.h"
+#include "ContextCodec.h"
+#include "BitReader.h"
 
 using namespace std;
 
@@ -338,6 +349,784 @@ void testUnbalancedTree() {
     else cout << "FAILED\n";
 }
 
+void testLongCanonicalCodes() {
+    cout << "\n========== TEST 13: Long Canonical Codes (Table Decoder) ==========\n";
+    // Fibonacci frequencies give one extra bit of depth per symbol, so the deepest codes
+    // go past the primary table, through the secondary tables, and into the slow path
+    string passage = "";
+    int a = 1, b = 1;
+    for (char c = 'a'; c <= 'z'; c++) {
+        passage += string(a, c);
+        int next = a + b;
+        a = b;
+        b = next;
+    }
+
+    HuffmanTree tree;
+    auto freqs = tree.countFrequencies(passage);
+    tree.buildTree(freqs);
+    tree.generateCodes();
+    tree.generateCanonicalCodes();
+
+    int longest = tree.getCanonicalTable().getMaxLength();
+    cout << "  Longest code: " << longest << " bits (Expected > "
+         << DecodeTable::kPrimaryBits + DecodeTable::kSecondaryBits << "): ";
+    if (longest > DecodeTable::kPrimaryBits + DecodeTable::kSecondaryBits) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string decoded = tree.decodeText(tree.encodeText(passage, true), true);
+    cout << "  Long-code Round-Trip: ";
+    if (decoded == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Truncating the stream must stop the decoder instead of emitting a bogus symbol
+    BitSet truncated;
+    BitSet lastCode = tree.getCanonicalCodes().at('a');
+    for (size_t i = 0; i + 1 < lastCode.size(); i++) truncated.append(lastCode.getBit(i));
+    cout << "  Truncated code: ";
+    if (tree.decodeText(truncated, true).empty()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testWordAppend() {
+    cout << "\n========== TEST 14: Word-Wise BitSet Append ==========\n";
+    // Append sets of awkward sizes at awkward offsets and compare against bit-by-bit appends
+    bool allMatch = true;
+    for (int prefixBits : {0, 1, 37, 63, 64, 65, 130}) {
+        for (int suffixBits : {0, 1, 63, 64, 100, 200}) {
+            BitSet prefix, suffix, expected;
+            for (int i = 0; i < prefixBits; i++) prefix.append(i % 3 == 0);
+            for (int i = 0; i < suffixBits; i++) suffix.append(i % 5 < 2);
+            for (int i = 0; i < prefixBits; i++) expected.append(prefix.getBit(i));
+            for (int i = 0; i < suffixBits; i++) expected.append(suffix.getBit(i));
+
+            BitSet combined = prefix;
+            combined.append(suffix);
+            if (combined != expected || combined.size() != (size_t)(prefixBits + suffixBits)
+                || combined.toBinaryString() != expected.toBinaryString()) {
+                allMatch = false;
+            }
+        }
+    }
+    cout << "  append(BitSet) matches bit-by-bit: ";
+    if (allMatch) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    BitSet bits;
+    bits.appendBits(0x5, 3);
+    bits.appendBits(0xFFFFFFFFFFFFFFFFULL, 64);
+    bits.appendBits(0x0, 5);
+    string expected = "101" + string(64, '1') + "00000";
+    cout << "  appendBits across word boundary: ";
+    if (bits.toBinaryString() == expected && bits.size() == 72) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    cout << "  Packed bytes: ";
+    if (bits.toHexString() == "bfffffffffffffffe0") cout << "PASSED\n";
+    else cout << "FAILED (Got " << bits.toHexString() << ")\n";
+
+    // getBytes() is cached; appending must drop the cache
+    vector<uint8_t> before = bits.copyBytes();
+    bits.appendBits(0x7, 3);
+    const vector<uint8_t>& after = bits.getBytes();
+    cout << "  Cached bytes follow appends: ";
+    if (before.size() == 9 && after.size() == 10 && after[8] == 0xE0 && after[9] == 0xE0
+        && bits.toHexString(2) == "bfff") cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testStreaming() {
+    cout << "\n========== TEST 15: Streaming Encode/Decode ==========\n";
+    // Several stream blocks' worth of text so codes straddle buffer boundaries
+    string passage = "";
+    for (int i = 0; i < 20000; i++) {
+        passage += "The quick brown fox jumps over the lazy dog. ";
+        passage += (char)('0' + i % 10);
+    }
+
+    stringstream input(passage);
+    HuffmanTree tree;
+    auto freqs = tree.countFrequencies(input);
+    tree.buildTree(freqs);
+    tree.generateCodes();
+    tree.generateCanonicalCodes();
+
+    cout << "  Stream frequencies match string frequencies: ";
+    if (freqs == tree.countFrequencies(passage)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    stringstream packed;
+    uint64_t bits = tree.encodeStream(input, packed);
+    BitSet expected = tree.encodeText(passage, true);
+    const vector<uint8_t>& expectedBytes = expected.getBytes();
+    string packedBytes = packed.str();
+    cout << "  Stream bits match encodeText: ";
+    if (bits == (uint64_t)expected.size()
+        && packedBytes == string(expectedBytes.begin(), expectedBytes.end())) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    stringstream output;
+    bool ok = tree.decodeStream(packed, output, passage.size());
+    cout << "  Stream Round-Trip: ";
+    if (ok && output.str() == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // A sampled table widened to every byte value can still encode the whole input
+    stringstream sampleInput("AAAAAAAABBBBC");
+    auto sampled = countFrequencies(sampleInput, 4);
+    includeAllBytes(sampled);
+    HuffmanTree sampledTree;
+    sampledTree.buildTree(sampled);
+    sampledTree.generateCodes();
+    sampledTree.generateCanonicalCodes();
+    stringstream sampledPacked, sampledOutput;
+    sampledTree.encodeStream(sampleInput, sampledPacked);
+    ok = sampledTree.decodeStream(sampledPacked, sampledOutput, 13);
+    cout << "  Sampled table Round-Trip: ";
+    if (ok && sampled.size() == 256 && sampledOutput.str() == "AAAAAAAABBBBC") cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testContainerFormat() {
+    cout << "\n========== TEST 16: Compressed Container Format ==========\n";
+    string passages[] = {
+        "The quick brown fox jumps over the lazy dog.",
+        "AAAA",
+        "",
+        string(5000, 'x') + "yz"
+    };
+
+    bool allPassed = true;
+    for (const string& passage : passages) {
+        stringstream input(passage), packed, output;
+        if (!compressStream(input, packed) || !decompressStream(packed, output)
+            || output.str() != passage) {
+            allPassed = false;
+        }
+    }
+    cout << "  Container Round-Trip: ";
+    if (allPassed) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string passage = "Polished and muscular and torsional.";
+    stringstream input(passage), packed;
+    compressStream(input, packed);
+    string compressed = packed.str();
+
+    // Lengths fit in nibbles here, so the header is 4 + 1 + 8 + 128 bytes
+    HuffmanFileHeader header;
+    stringstream headerStream(compressed);
+    cout << "  Header rebuilds code lengths: ";
+    HuffmanTree tree;
+    tree.buildTree(tree.countFrequencies(passage));
+    tree.generateCodes();
+    tree.generateCanonicalCodes();
+    if (readHeader(headerStream, header) && header.originalLength == passage.size()
+        && header.codeLengths == tree.getCanonicalCodeLengths()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string corrupt = compressed;
+    corrupt[141] ^= 0x10;
+    stringstream corruptStream(corrupt), corruptOutput;
+    cout << "  Corrupt payload rejected: ";
+    if (!decompressStream(corruptStream, corruptOutput)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string badMagic = compressed;
+    badMagic[0] = 'X';
+    stringstream badMagicStream(badMagic), badMagicOutput;
+    cout << "  Bad magic rejected: ";
+    if (!decompressStream(badMagicStream, badMagicOutput)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testBlockParallel() {
+    cout << "\n========== TEST 17: Block-Parallel Compression ==========\n";
+    string passage = "";
+    for (int i = 0; i < 3000; i++) {
+        passage += "Maps and mazes. Of a thing which could not be put back. ";
+        passage += (char)(i % 256);
+    }
+
+    // Small blocks so the passage spans many of them, including a short last block
+    BlockEncoded encoded = compressBlocks(passage, 4, 1000);
+    cout << "  Blocks: " << encoded.blockOffsets.size() << " (Expected "
+         << (passage.size() + 999) / 1000 << "): ";
+    if (encoded.blockOffsets.size() == (passage.size() + 999) / 1000) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string decoded;
+    cout << "  Block Round-Trip: ";
+    if (decompressBlocks(encoded, decoded, 4) && decoded == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    stringstream packed;
+    writeBlocks(packed, encoded);
+    BlockEncoded reread;
+    string rereadDecoded;
+    cout << "  Serialized Block Round-Trip: ";
+    if (readBlocks(packed, reread) && decompressBlocks(reread, rereadDecoded, 2)
+        && rereadDecoded == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    encoded.payload[encoded.payload.size() / 2] ^= 0x01;
+    cout << "  Corrupt block rejected: ";
+    if (!decompressBlocks(encoded, decoded, 4)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    BlockEncoded empty = compressBlocks(string(), 4);
+    cout << "  Empty input: ";
+    if (empty.blockOffsets.empty() && decompressBlocks(empty, decoded) && decoded.empty()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // The pool's workers persist between calls; a call from inside a task runs on its own thread
+    bool poolOk = true;
+    for (int call = 0; call < 50; call++) {
+        vector<int> hits(100, 0);
+        parallelFor(hits.size(), 4, [&](size_t i) {
+            int inner = 0;
+            parallelFor(3, 4, [&](size_t) { inner++; });
+            hits[i] += inner;
+        });
+        poolOk &= count(hits.begin(), hits.end(), 3) == 100;
+    }
+    cout << "  Repeated and nested parallelFor: ";
+    if (poolOk) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testFlatBuilder() {
+    cout << "\n========== TEST 18: Flat Array Tree Builder ==========\n";
+    // Many ties at several frequencies exercise the tiebreaker between the two queues
+    string passage = "";
+    for (int i = 0; i < 256; i++) {
+        passage += string(1 + (i * 7) % 5, (char)i);
+    }
+
+    HuffmanTree tree;
+    tree.buildTree(tree.countFrequencies(passage));
+    tree.generateCodes();
+
+    auto lengths = tree.getCodeLengths();
+    bool lengthsMatch = true;
+    for (const auto& pair : tree.getCodes()) {
+        if (lengths[(uint8_t)pair.first] != pair.second.size()) lengthsMatch = false;
+    }
+    cout << "  Code lengths match generated codes: ";
+    if (lengthsMatch && tree.getCodes().size() == 256) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    cout << "  Tied-frequency Round-Trip: ";
+    if (tree.decodeText(tree.encodeText(passage)) == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testLengthLimitedCodes() {
+    cout << "\n========== TEST 19: Length-Limited Canonical Codes ==========\n";
+    // Same Fibonacci passage as TEST 13: unlimited, its deepest code is 25 bits
+    string passage = "";
+    int a = 1, b = 1;
+    for (char c = 'a'; c <= 'z'; c++) {
+        passage += string(a, c);
+        int next = a + b;
+        a = b;
+        b = next;
+    }
+
+    HuffmanTree tree;
+    tree.buildTree(tree.countFrequencies(passage));
+    tree.generateCodes();
+    tree.generateCanonicalCodes();
+    size_t unlimitedBits = tree.encodeText(passage, true).size();
+
+    for (int limit : {12, 5}) {
+        tree.generateCanonicalCodes(limit);
+        auto lengths = tree.getCanonicalCodeLengths();
+        int longest = *max_element(lengths.begin(), lengths.end());
+
+        // Kraft sum must be exactly 1 for an optimal (complete) prefix code
+        uint64_t kraft = 0;
+        for (uint8_t len : lengths) {
+            if (len > 0) kraft += (uint64_t)1 << (limit - len);
+        }
+
+        BitSet encoded = tree.encodeText(passage, true);
+        cout << "  Limit " << limit << ": longest " << longest << " bits, "
+             << encoded.size() << " vs " << unlimitedBits << " unlimited bits: ";
+        if (longest <= limit && kraft == ((uint64_t)1 << limit) && encoded.size() >= unlimitedBits
+            && tree.decodeText(encoded, true) == passage) cout << "PASSED\n";
+        else cout << "FAILED\n";
+    }
+
+    // 26 symbols cannot fit in 4 bits
+    array<uint8_t, 256> lengths;
+    cout << "  Impossible limit rejected: ";
+    if (!limitCodeLengths(tree.getFrequencies(), 4, lengths)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Through the tree, an impossible limit reports failure and keeps the unlimited codes
+    bool limited = tree.generateCanonicalCodes(4);
+    BitSet unlimitedEncoding = tree.encodeText(passage, true);
+    cout << "  Impossible limit keeps unlimited codes: ";
+    if (!limited && tree.getCanonicalCodes().size() == 26 && unlimitedEncoding.size() == unlimitedBits
+        && tree.decodeText(unlimitedEncoding, true) == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // A limit the tree already meets leaves the codes alone
+    HuffmanTree simple;
+    simple.buildTree(simple.countFrequencies("AAAABBBCCCDDEEF"));
+    simple.generateCodes();
+    simple.generateCanonicalCodes(15);
+    cout << "  Loose limit leaves codes unchanged: ";
+    if (simple.getCanonicalCodes().at('F').toBinaryString() == "111") cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testHistogram() {
+    cout << "\n========== TEST 20: Multi-Table Histogram ==========\n";
+    // Long enough to be split across threads, with an odd tail for the unrolled loop
+    string passage = "";
+    for (int i = 0; i < 3 * 1024 * 1024 + 3; i++) {
+        passage += (char)((i * 31 + i / 7) % 256);
+    }
+
+    map<char, int> expected;
+    for (char c : passage) expected[c]++;
+
+    cout << "  Single-threaded counts: ";
+    if (countFrequencies(passage) == expected) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    cout << "  Chunked parallel counts: ";
+    if (countFrequencies(passage, 4) == expected) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    Histogram counts = countHistogram("AAB", 3);
+    cout << "  Short input: ";
+    if (counts['A'] == 2 && counts['B'] == 1 && counts['C'] == 0) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Counts past INT_MAX are scaled down together rather than clamped one by one
+    Histogram huge{};
+    huge['A'] = 8ull << 32;
+    huge['B'] = 2ull << 32;
+    huge['C'] = 1;
+    map<char, int> scaled = histogramToFrequencies(huge);
+    cout << "  Large counts scaled in proportion: ";
+    if (scaled.size() == 3 && scaled['A'] == 4 * scaled['B'] && scaled['C'] == 1) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testAdaptiveBlocks() {
+    cout << "\n========== TEST 21: Adaptive Per-Block Tables ==========\n";
+    // Text, then pseudo-random binary, then text again: three regimes for the block chooser
+    string text = "";
+    while (text.size() < 3 * kAdaptiveBlockSize) {
+        text += "In the deep glens where they lived all things were older than man. ";
+    }
+    string binary = "";
+    uint32_t state = 343;
+    for (size_t i = 0; i < 2 * kAdaptiveBlockSize; i++) {
+        state = state * 1103515245 + 12345;
+        binary += (char)(state >> 16);
+    }
+    string passage = text + binary + text;
+
+    stringstream packed;
+    AdaptiveStats stats = compressAdaptive(passage, packed);
+    cout << "  Blocks: " << stats.newTableBlocks << " new table, " << stats.reusedBlocks
+         << " reused, " << stats.rawBlocks << " raw: ";
+    if (stats.newTableBlocks >= 1 && stats.reusedBlocks >= 1 && stats.rawBlocks >= 1) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string decoded;
+    cout << "  Adaptive Round-Trip: ";
+    if (decompressAdaptive(packed, decoded) && decoded == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    stringstream input(passage), single;
+    compressStream(input, single);
+    cout << "  Adaptive " << packed.str().size() << " bytes vs single table "
+         << single.str().size() << " bytes: ";
+    if (packed.str().size() < single.str().size()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string corrupt = packed.str();
+    corrupt[corrupt.size() / 3] ^= 0x40;
+    stringstream corruptStream(corrupt);
+    cout << "  Corrupt stream rejected: ";
+    if (!decompressAdaptive(corruptStream, decoded)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // 17 bytes claiming a 4 GB raw block: must fail at end of input, not allocate the block
+    string oversized = string("HUA1") + string("\x00\x00\x00\x00\x01\x00\x00\x00", 8)
+                       + string("\xff\xff\xff\xff", 4) + (char)kAdaptiveRaw;
+    stringstream oversizedStream(oversized);
+    cout << "  Oversized block rejected: ";
+    if (!decompressAdaptive(oversizedStream, decoded)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testEncodeTable() {
+    cout << "\n========== TEST 22: Encode Lookup Table ==========\n";
+    string passage = "Once there were brook trouts in the streams in the mountains.";
+    HuffmanTree tree;
+    tree.buildTree(tree.countFrequencies(passage));
+    tree.generateCodes();
+    tree.generateCanonicalCodes();
+
+    // Reference: append each character's code BitSet, as encodeText used to
+    BitSet expected;
+    for (char c : passage) expected.append(tree.getCanonicalCodes().at(c));
+    cout << "  Table encode matches per-code append: ";
+    if (tree.encodeText(passage, true) == expected) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    EncodeTable fromCodes, fromLengths;
+    fromCodes.build(tree.getCanonicalCodes());
+    fromLengths.build(tree.getCanonicalCodeLengths());
+    bool sameTable = true;
+    for (int i = 0; i < 256; i++) {
+        sameTable &= fromCodes.getBits(i) == fromLengths.getBits(i) && fromCodes.getLength(i) == fromLengths.getLength(i);
+    }
+    cout << "  Table from code lengths matches: ";
+    if (sameTable) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Canonical codes come from the lengths alone, so generateCodes() is not needed first
+    HuffmanTree lengthsOnly;
+    lengthsOnly.buildTree(lengthsOnly.countFrequencies(passage));
+    lengthsOnly.generateCanonicalCodes();
+    cout << "  Canonical codes without generateCodes: ";
+    if (lengthsOnly.encodeText(passage, true) == expected
+        && lengthsOnly.getCanonicalCodes() == tree.getCanonicalCodes()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    cout << "  Unknown character throws: ";
+    try {
+        tree.encodeText("Zebra", true);
+        cout << "FAILED\n";
+    } catch (const out_of_range&) {
+        cout << "PASSED\n";
+    }
+}
+
+void testMultiStream() {
+    cout << "\n========== TEST 23: Four-Stream Interleaved Decoding ==========\n";
+    string passage = "";
+    while (passage.size() < 100003) {
+        passage += "The river ran clear and cold over the stones below the bridge. ";
+    }
+    passage.resize(100003);
+
+    MultiStreamEncoded encoded = compressMultiStream(passage);
+    string decoded;
+    cout << "  Four-Stream Round-Trip: ";
+    if (decompressMultiStream(encoded, decoded) && decoded == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    stringstream packed;
+    writeMultiStream(packed, encoded);
+    MultiStreamEncoded read;
+    cout << "  Serialized Round-Trip: ";
+    if (readMultiStream(packed, read) && decompressMultiStream(read, decoded) && decoded == passage) {
+        cout << "PASSED\n";
+    } else {
+        cout << "FAILED\n";
+    }
+
+    // Fewer characters than streams: the first three segments are empty
+    cout << "  Short Inputs: ";
+    bool shortOk = true;
+    for (string text : {string(), string("a"), string("abc"), string("abcde")}) {
+        shortOk &= decompressMultiStream(compressMultiStream(text), decoded) && decoded == text;
+    }
+    if (shortOk) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    MultiStreamEncoded truncated = encoded;
+    truncated.streamBits[2] -= 64;
+    cout << "  Truncated stream rejected: ";
+    if (!decompressMultiStream(truncated, decoded)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testMappedFiles() {
+    cout << "\n========== TEST 24: Memory-Mapped File Compression ==========\n";
+    string passage = "";
+    while (passage.size() < 3 * kDefaultBlockSize / 2) {
+        passage += "They smelled of moss in your hand. Polished and muscular and torsional. ";
+    }
+    string inputPath = "huffman_test_input.txt";
+    string packedPath = "huffman_test_input.huf";
+    string outputPath = "huffman_test_output.txt";
+    {
+        ofstream input(inputPath, ios::binary);
+        input << passage;
+    }
+
+    cout << "  Mapped Round-Trip: ";
+    bool ok = compressBlockFile(inputPath, packedPath, 2) && decompressBlockFile(packedPath, outputPath, 2);
+    ifstream output(outputPath, ios::binary);
+    string decoded((istreambuf_iterator<char>(output)), istreambuf_iterator<char>());
+    if (ok && decoded == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // The mapped writer must produce the same bytes as writeBlocks
+    ifstream packedFile(packedPath, ios::binary);
+    string packed((istreambuf_iterator<char>(packedFile)), istreambuf_iterator<char>());
+    stringstream expected;
+    writeBlocks(expected, compressBlocks(passage, 2));
+    cout << "  Matches stream writer: ";
+    if (packed == expected.str()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    {
+        ofstream truncated(packedPath, ios::binary);
+        truncated << packed.substr(0, packed.size() / 2);
+    }
+    cout << "  Truncated file rejected: ";
+    if (!decompressBlockFile(packedPath, outputPath, 2)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Failing before the output is created, or (for the truncated file) after it has been
+    // partly written, must leave an existing file alone
+    bool keptMissing = !compressBlockFile("huffman_test_missing.txt", outputPath, 2);
+    bool keptNotContainer = !decompressBlockFile(inputPath, outputPath, 2);
+    ifstream kept(outputPath, ios::binary);
+    string keptContents((istreambuf_iterator<char>(kept)), istreambuf_iterator<char>());
+    cout << "  Existing output kept on failure: ";
+    if (keptMissing && keptNotContainer && keptContents == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Writing over the input while it is mapped would destroy it
+    bool sameRejected = !compressBlockFile(inputPath, inputPath, 2) && !decompressBlockFile(inputPath, inputPath, 2);
+    ifstream same(inputPath, ios::binary);
+    string sameContents((istreambuf_iterator<char>(same)), istreambuf_iterator<char>());
+    cout << "  Same input and output rejected: ";
+    if (sameRejected && sameContents == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    remove(inputPath.c_str());
+    remove(packedPath.c_str());
+    remove(outputPath.c_str());
+}
+
+void testStaticDictionary() {
+    cout << "\n========== TEST 25: Static Dictionary Messages ==========\n";
+    string training = "";
+    while (training.size() < 20000) {
+        training += "Once there were brook trouts in the streams in the mountains. Maps and mazes. ";
+    }
+    StaticDictionary dictionary = trainDictionary(7, training);
+    DictionarySet dictionaries;
+    dictionaries.add(dictionary);
+
+    // Includes characters the training text never saw
+    string message = "On their backs were vermiculate patterns: {Zq|X} 42%";
+    string packed = encodeMessage(dictionary, message);
+    string decoded;
+    cout << "  Message Round-Trip: ";
+    if (decodeMessage(dictionaries, packed, decoded) && decoded == message) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    cout << "  Message smaller than original: ";
+    if (packed.size() < message.size()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Persist by ID and decode with the reloaded table
+    StaticDictionary reloaded;
+    bool saved = saveDictionary(".", dictionary) && loadDictionary(".", 7, reloaded);
+    remove(dictionaryPath(".", 7).c_str());
+    DictionarySet reloadedSet;
+    reloadedSet.add(reloaded);
+    cout << "  Saved Dictionary Round-Trip: ";
+    if (saved && decodeMessage(reloadedSet, packed, decoded) && decoded == message) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string unknown = packed;
+    unknown[0] = 8;
+    cout << "  Unknown dictionary and truncation rejected: ";
+    if (!decodeMessage(dictionaries, unknown, decoded)
+        && !decodeMessage(dictionaries, packed.substr(0, packed.size() - 4), decoded)) {
+        cout << "PASSED\n";
+    } else {
+        cout << "FAILED\n";
+    }
+
+    // The payload is packed straight into the message, trimmed to the codes' own size
+    BitSet codes;
+    dictionary.getEncodeTable().encode(message.data(), message.size(), codes);
+    string empty = encodeMessage(dictionary, "");
+    cout << "  Payload trimmed to its codes: ";
+    if (packed.size() == kMessageHeaderSize + codes.sizeInBytes()
+        && packed.substr(kMessageHeaderSize) == string(codes.getBytes().begin(), codes.getBytes().end())
+        && empty.size() == kMessageHeaderSize && decodeMessage(dictionaries, empty, decoded) && decoded.empty()) {
+        cout << "PASSED\n";
+    } else {
+        cout << "FAILED\n";
+    }
+
+    // The length field is 4 bytes; the check comes before any data is read
+    bool tooLongRejected = false;
+    try {
+        encodeMessage(dictionary, message.data(), (size_t)UINT32_MAX + 1);
+    } catch (const length_error&) {
+        tooLongRejected = true;
+    }
+    cout << "  Message of 4 GB rejected: ";
+    if (tooLongRejected) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testContextModel() {
+    cout << "\n========== TEST 26: Order-1 Context Tables ==========\n";
+    string passage = "";
+    while (passage.size() < 200000) {
+        passage += "Once there were brook trouts in the streams in the mountains. "
+                   "You could see them standing in the amber current where the white edges of their fins "
+                   "wimpled softly in the flow. They smelled of moss in your hand. ";
+    }
+
+    stringstream packed;
+    ContextStats stats = compressContext(passage, packed);
+    string decoded;
+    cout << "  Context Round-Trip (" << stats.contextTables << " context tables): ";
+    if (stats.contextTables > 0 && decompressContext(packed, decoded) && decoded == passage) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    stringstream input(passage), single;
+    compressStream(input, single);
+    cout << "  Context " << packed.str().size() << " bytes vs order-0 " << single.str().size() << " bytes: ";
+    if (packed.str().size() < single.str().size()) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Too short for any context table to pay for itself
+    cout << "  Short Inputs Use Shared Table: ";
+    bool shortOk = true;
+    for (string text : {string(), string("a"), string("Maps and mazes.")}) {
+        stringstream small;
+        shortOk &= compressContext(text, small).contextTables == 0 && decompressContext(small, decoded) && decoded == text;
+    }
+    if (shortOk) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    string corrupt = packed.str();
+    corrupt[corrupt.size() / 2] ^= 0x10;
+    stringstream corruptStream(corrupt);
+    cout << "  Corrupt stream rejected: ";
+    if (!decompressContext(corruptStream, decoded)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testBitReader() {
+    cout << "\n========== TEST 27: Buffered Bit Reader ==========\n";
+    // Odd length, so the BitSet has a partial tail word and the bytes a partial last byte
+    BitSet bits;
+    uint32_t state = 343;
+    for (int i = 0; i < 1000; i++) {
+        state = state * 1103515245 + 12345;
+        bits.appendBits(state >> 8, 1 + (int)(state % 23));
+    }
+    const std::vector<uint8_t>& bytes = bits.getBytes();
+
+    cout << "  readBit matches getBit: ";
+    BitReader wordReader(bits);
+    BitReader byteReader(bytes.data(), bits.size());
+    bool same = true;
+    for (size_t i = 0; i < bits.size(); i++) {
+        same &= wordReader.readBit() == bits.getBit(i) && byteReader.readBit() == bits.getBit(i);
+    }
+    same &= wordReader.atEnd() && byteReader.atEnd();
+    if (same) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // Variable-width peek/consume, including reads that cross word boundaries
+    cout << "  peek/consume matches getBit: ";
+    BitReader reader(bits);
+    bool peeked = true;
+    for (int width = 1; !reader.atEnd(); width = width % BitReader::kMaxPeekBits + 1) {
+        reader.refill();
+        int n = min(width, reader.available());
+        uint64_t expected = 0;
+        for (int i = 0; i < n; i++) expected = (expected << 1) | (bits.getBit(reader.tell() + i) ? 1 : 0);
+        peeked &= reader.peek(n) == expected;
+        reader.consume(n);
+    }
+    if (peeked) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    cout << "  Window is zero past the end: ";
+    BitReader end(bits);
+    while (end.remaining() > 5) {
+        end.refill();
+        end.consume(min(end.available(), (int)end.remaining() - 5));
+    }
+    end.refill();
+    if (end.available() == 5 && (end.peekWindow() << 5) == 0) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
+void testValidatedDecode() {
+    cout << "\n========== TEST 28: Validated Decoding ==========\n";
+    HuffmanTree tree;
+    string passage = "Maps and mazes. Of a thing which could not be put back.";
+    tree.buildTree(tree.countFrequencies(passage));
+    tree.generateCodes();
+    tree.generateCanonicalCodes();
+    string decoded;
+
+    cout << "  Valid input accepted: ";
+    if (tree.decodeText(tree.encodeText(passage), false, decoded) && decoded == passage
+        && tree.decodeText(tree.encodeText(passage, true), true, decoded) && decoded == passage) {
+        cout << "PASSED\n";
+    } else {
+        cout << "FAILED\n";
+    }
+
+    // Ends one bit short of the last code
+    bool truncatedRejected = true;
+    for (bool canonical : {false, true}) {
+        BitSet encoded = tree.encodeText(passage, canonical);
+        BitSet truncated;
+        for (size_t i = 0; i + 1 < encoded.size(); i++) truncated.append(encoded.getBit(i));
+        truncatedRejected &= !tree.decodeText(truncated, canonical, decoded);
+    }
+    cout << "  Truncated code rejected: ";
+    if (truncatedRejected) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // A single-symbol tree has no right child under its root, so any 1 bit is not a code
+    HuffmanTree single;
+    single.buildTree(single.countFrequencies("aaaa"));
+    single.generateCodes();
+    cout << "  Missing child rejected: ";
+    if (!single.decodeText(BitSet("0010"), false, decoded) && decoded == "aa") cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    // One 1-bit code misses in the primary table; one 20-bit code misses on the slow path
+    array<uint8_t, 256> shortLengths{}, longLengths{};
+    shortLengths['a'] = 1;
+    longLengths['a'] = 20;
+    uint8_t missSymbol = 0xAB, slowMissSymbol = 0xAB;
+    int missLength = DecodeTable(shortLengths).decode(~(uint64_t)0, missSymbol);
+    int slowMissLength = DecodeTable(longLengths).decode((uint64_t)1 << (63 - 19), slowMissSymbol);
+    cout << "  Invalid window clears symbol: ";
+    if (missLength == 0 && missSymbol == 0 && slowMissLength == 0 && slowMissSymbol == 0) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    uint8_t unbuiltSymbol = 0xAB;
+    int unbuiltLength = DecodeTable().decode(0, unbuiltSymbol);
+    cout << "  Unbuilt table decodes nothing: ";
+    if (unbuiltLength == 0 && unbuiltSymbol == 0) cout << "PASSED\n";
+    else cout << "FAILED\n";
+
+    HuffmanTree empty;
+    cout << "  Bits without a tree rejected: ";
+    if (!empty.decodeText(BitSet("0"), false, decoded)) cout << "PASSED\n";
+    else cout << "FAILED\n";
+}
+
 int testMain() {
     cout << "\n";
     cout << "╔════════════════════════════════════════════════════╗\n";
@@ -356,6 +1145,22 @@ int testMain() {
     testAll256Characters();
     testBitBoundaries();
     testUnbalancedTree();
+    testLongCanonicalCodes();
+    testWordAppend();
+    testStreaming();
+    testContainerFormat();
+    testBlockParallel();
+    testFlatBuilder();
+    testLengthLimitedCodes();
+    testHistogram();
+    testAdaptiveBlocks();
+    testEncodeTable();
+    testMultiStream();
+    testMappedFiles();
+    testStaticDictionary();
+    testContextModel();
+    testBitReader();
+    testValidatedDecode();
 
     cout << "\n";
     cout << "╔════════════════════════════════════════════════════╗\n";
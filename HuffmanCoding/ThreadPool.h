@@ -0,0 +1,138 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * Default worker count: one per hardware thread, at least one.
+ */
+inline unsigned defaultThreadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Persistent worker threads for parallelFor. Workers are started the first time a call needs
+// them and then sleep between calls, so repeated block encodes and decodes pay no thread
+// start-up. The pool runs one call at a time; a call made while it is busy (from another thread,
+// or from inside a task) runs on its calling thread alone.
+class ThreadPool {
+public:
+    // The process-wide pool; its workers are joined at exit
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    ThreadPool() : generation(0), helpersWanted(0), helpersJoined(0), helpersDone(0), stopping(false) {}
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs fn(i) for every i in [0, count) on the calling thread and threads - 1 workers
+    template <typename Fn>
+    void run(size_t count, unsigned threads, Fn& fn) {
+        std::unique_lock<std::mutex> busy(runMutex, std::try_to_lock);
+        if (threads <= 1 || !busy.owns_lock()) {
+            for (size_t i = 0; i < count; i++) fn(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (workers.size() < threads - 1) {
+                workers.emplace_back([this] { workerLoop(); });
+            }
+            job = Job{&callTask<Fn>, &fn, count};
+            next = 0;
+            helpersWanted = threads - 1;
+            helpersJoined = 0;
+            helpersDone = 0;
+            generation++;
+        }
+        wake.notify_all();
+
+        work(job);
+        // Every helper has to finish before fn goes out of scope, even one that found no work
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return helpersDone == helpersWanted; });
+    }
+
+private:
+    struct Job {
+        void (*body)(void* fn, size_t index);
+        void* fn;
+        size_t count;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex runMutex;    // held for the length of a run()
+    std::mutex mutex;       // guards everything below except next
+    std::condition_variable wake;
+    std::condition_variable finished;
+    Job job;
+    std::atomic<size_t> next;
+    uint64_t generation;    // bumped per run(), so a worker joins each job at most once
+    unsigned helpersWanted;
+    unsigned helpersJoined;
+    unsigned helpersDone;
+    bool stopping;
+
+    template <typename Fn>
+    static void callTask(void* fn, size_t index) {
+        (*(Fn*)fn)(index);
+    }
+
+    // Workers pull the next index from a shared counter, so uneven tasks still balance
+    void work(const Job& current) {
+        for (size_t i = next++; i < current.count; i = next++) {
+            current.body(current.fn, i);
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || (generation != seen && helpersJoined < helpersWanted); });
+            if (stopping) return;
+            seen = generation;
+            helpersJoined++;
+            Job current = job;
+            lock.unlock();
+            work(current);
+            lock.lock();
+            if (++helpersDone == helpersWanted) finished.notify_one();
+        }
+    }
+};
+
+/**
+ * Runs fn(i) for every i in [0, count) on the shared ThreadPool. Returns once every task is done.
+ * @param count Number of tasks.
+ * @param threads Number of threads; the calling thread is one of them.
+ * @param fn Task body; must be safe to call concurrently for different indices, and must not throw.
+ */
+template <typename Fn>
+void parallelFor(size_t count, unsigned threads, Fn fn) {
+    threads = (unsigned)std::min<size_t>(std::max(threads, 1u), std::max<size_t>(count, 1));
+    ThreadPool::shared().run(count, threads, fn);
+}
+
+#endif //THREADPOOL_H
@@ -6,6 +6,8 @@
 #include <algorithm>
 #include "BitSet.h"
 #include "HuffmanTree.h"
+#include "BlockCodec.h"
+#include <cstdlib>
 
 using namespace std;
 
@@ -14,7 +16,7 @@ int testMain();
 // Structure for sorting codes by length then character
 struct CodeEntry {
     char character;
-    int numBits;
+    size_t numBits;
     BitSet code;
 };
 
@@ -53,7 +55,58 @@ void printCodeTable(const map<char, BitSet>& codes) {
     }
 }
 
-int main() {
+void printUsage() {
+    cerr << "Usage: HuffmanCoding (-c | -d) [--threads N] <input> <output>\n"
+         << "  -c           compress input into the block format\n"
+         << "  -d           decompress a file written by -c\n"
+         << "  --threads N  worker threads (default: one per hardware thread)\n"
+         << "With no arguments, prints the assignment output and runs the tests.\n";
+}
+
+// Batch compressor mode; returns the process exit code
+int runCommandLine(int argc, char* argv[]) {
+    char mode = 0;
+    unsigned threads = defaultThreadCount();
+    vector<string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-c" || arg == "-d") {
+            mode = arg[1];
+        } else if (arg == "--threads") {
+            int n = i + 1 < argc ? atoi(argv[++i]) : 0;
+            if (n < 1) {
+                printUsage();
+                return 2;
+            }
+            threads = (unsigned)n;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            // An unknown option, not a path
+            printUsage();
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (mode == 0 || paths.size() != 2) {
+        printUsage();
+        return 2;
+    }
+
+    bool ok = mode == 'c' ? compressBlockFile(paths[0], paths[1], threads)
+                          : decompressBlockFile(paths[0], paths[1], threads);
+    if (!ok) {
+        cerr << "HuffmanCoding: " << (mode == 'c' ? "compressing " : "decompressing ") << paths[0] << " failed\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return runCommandLine(argc, argv);
+    }
+
     // Assignment output: Process The Road passage
     string passage =
         "Once there were brook trouts in the streams in the mountains. "
@@ -97,9 +150,9 @@ int main() {
     cout << "\n";
 
     // Output size information
-    int bitsCompressed = encoded.size();
-    int bytesCompressed = encoded.sizeInBytes();
-    int bitsUncompressed = passage.length() * 8;
+    size_t bitsCompressed = encoded.size();
+    size_t bytesCompressed = encoded.sizeInBytes();
+    size_t bitsUncompressed = passage.length() * 8;
     double compressionRatio = (double)bitsCompressed / (double)bitsUncompressed;
 
     cout << "\nCompressed size: " << bitsCompressed << " bits (" << bytesCompressed << " bytes)\n";